@@ -0,0 +1,328 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "batch.h"
+#include "compressor.h"
+#include "encoding.h"
+#include "encode_table.h"
+
+/*
+A batch of files coded by the worker threads of code_batch().
+<table> is the encode table of <encoding> when compressing (NULL otherwise). It is shared
+read-only between the workers.
+<nextFile> is the index of the next file of the list that no worker has taken yet, and <stats>
+the totals of the batch. Both are guarded by <lock>.
+<rets>[i] is set to the return value of coding file i. Files that already failed before the
+workers started (see mark_duplicate_outputs()) are skipped by the workers.
+*/
+typedef struct batch {
+    char **inputPaths;
+    char **outputPaths;
+    int numFiles;
+    bool compressing;
+    Encoding *encoding;
+    EncodeTable *table;
+    bool adaptive;
+    int maxLength;
+    int numStreams;
+    pthread_mutex_t lock;
+    int nextFile;
+    BatchStats *stats;
+    int *rets;
+} Batch;
+
+/*
+Initializes and returns new empty batch totals
+*/
+BatchStats newBatchStats() {
+    BatchStats stats;
+    memset(&stats, 0, sizeof(stats));
+    return stats;
+}
+
+/*
+Write the totals <stats> of compressing (if <compressing> is true) or decompressing a batch to
+<file>, as a single JSON object if <json> is true and as lines of text otherwise.
+
+Besides the totals this reports the compression ratio (the compressed size divided by the
+uncompressed size) and the throughput in uncompressed megabytes and in files per second.
+*/
+void print_batch_stats(FILE *file, BatchStats *stats, bool compressing, bool json) {
+    uint64_t compressedBytes = compressing ? stats->outputBytes : stats->inputBytes;
+    uint64_t uncompressedBytes = compressing ? stats->inputBytes : stats->outputBytes;
+    double ratio = uncompressedBytes > 0 ? (double) compressedBytes / uncompressedBytes : 0;
+    double mbPerSecond = stats->seconds > 0 ? uncompressedBytes / stats->seconds / 1e6 : 0;
+    double filesPerSecond = stats->seconds > 0 ? stats->numFiles / stats->seconds : 0;
+
+    if (json) {
+        fprintf(file, "{\"mode\": \"%s\", \"files\": %llu, \"failed\": %llu, \"seconds\": %.6f,"
+                      " \"input_bytes\": %llu, \"output_bytes\": %llu, \"ratio\": %.6f,"
+                      " \"mb_per_s\": %.1f, \"files_per_s\": %.1f}\n",
+                compressing ? "compress" : "decompress", (unsigned long long) stats->numFiles,
+                (unsigned long long) stats->numFailed, stats->seconds,
+                (unsigned long long) stats->inputBytes, (unsigned long long) stats->outputBytes,
+                ratio, mbPerSecond, filesPerSecond);
+        return;
+    }
+
+    fprintf(file, "%-18s %llu\n", "files", (unsigned long long) stats->numFiles);
+    fprintf(file, "%-18s %llu\n", "failed", (unsigned long long) stats->numFailed);
+    fprintf(file, "%-18s %.6f s\n", "time", stats->seconds);
+    fprintf(file, "%-18s %llu bytes\n", "input", (unsigned long long) stats->inputBytes);
+    fprintf(file, "%-18s %llu bytes\n", "output", (unsigned long long) stats->outputBytes);
+    fprintf(file, "%-18s %.4f\n", "ratio", ratio);
+    fprintf(file, "%-18s %.1f MB/s\n", "throughput", mbPerSecond);
+    fprintf(file, "%-18s %.1f files/s\n", "files per second", filesPerSecond);
+}
+
+/*
+Helper for batch_worker().
+Code file <i> of <batch> on this thread and add its input and output sizes to <inputBytes>
+and <outputBytes> if it was coded.
+
+Returns 0 on success.
+Returns the error of coding the file otherwise (see code_batch()).
+*/
+static int code_file(Batch *batch, int i, uint64_t *inputBytes, uint64_t *outputBytes) {
+    char *inputPath = batch->inputPaths[i];
+    char *outputPath = batch->outputPaths[i];
+    FILE *inputFile = fopen(inputPath, "r");
+    if (inputFile == NULL) {
+        fprintf(stderr, "%s: failed to open the input file\n", inputPath);
+        return 3;
+    }
+    FILE *outputFile = fopen(outputPath, "w");
+    if (outputFile == NULL) {
+        fprintf(stderr, "%s: failed to create the output file %s\n", inputPath, outputPath);
+        fclose(inputFile);
+        return 2;
+    }
+
+    int ret;
+    if (batch->compressing) {
+        ret = encode_file_with_table(inputFile, outputFile, batch->encoding, batch->table,
+                                     batch->adaptive, batch->maxLength, batch->numStreams, 1,
+                                     NULL);
+    } else {
+        ret = decode_file(inputFile, outputFile, batch->encoding, 1, NULL);
+    }
+
+    struct stat inputStat;
+    if (ret == 0 && fstat(fileno(inputFile), &inputStat) == 0) {
+        *inputBytes += inputStat.st_size;
+    }
+    long outputSize = ftell(outputFile);
+    // Closing writes out what is left in the output buffer, which may fail too
+    if (fclose(outputFile) != 0 && ret == 0) {
+        ret = 2;
+    }
+    fclose(inputFile);
+
+    if (ret != 0) {
+        fprintf(stderr, "%s: %s (error %d)\n", inputPath, coding_error(ret, batch->compressing), ret);
+        remove(outputPath);
+        return ret;
+    }
+    if (outputSize > 0) {
+        *outputBytes += outputSize;
+    }
+    return 0;
+}
+
+/*
+Helper for code_batch().
+Code the files of the Batch pointed to by <arg> until every file has been taken by a worker.
+Used as a pthread start routine.
+*/
+static void *batch_worker(void *arg) {
+    Batch *batch = arg;
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        int i = batch->nextFile;
+        if (i < batch->numFiles) {
+            batch->nextFile++;
+        }
+        pthread_mutex_unlock(&batch->lock);
+        if (i >= batch->numFiles) {
+            return NULL;
+        }
+        if (batch->rets[i] != 0) {
+            continue;
+        }
+
+        uint64_t inputBytes = 0;
+        uint64_t outputBytes = 0;
+        int ret = code_file(batch, i, &inputBytes, &outputBytes);
+        batch->rets[i] = ret;
+
+        pthread_mutex_lock(&batch->lock);
+        batch->stats->inputBytes += inputBytes;
+        batch->stats->outputBytes += outputBytes;
+        if (ret != 0) {
+            batch->stats->numFailed++;
+        }
+        pthread_mutex_unlock(&batch->lock);
+    }
+}
+
+/*
+An output path of a batch and the index of its file in the list, for finding the files that
+share an output path.
+*/
+typedef struct output_entry {
+    const char *path;
+    int file;
+} OutputEntry;
+
+/*
+Helper for mark_duplicate_outputs() to order output entries with qsort() by path and then by
+their index in the list.
+*/
+static int compare_output_entries(const void *a, const void *b) {
+    const OutputEntry *entry = a;
+    const OutputEntry *other = b;
+    int cmp = strcmp(entry->path, other->path);
+    return cmp != 0 ? cmp : entry->file - other->file;
+}
+
+/*
+Helper for code_batch().
+Fail every file of <batch> whose output path is the output path of an earlier file of the list,
+so no two files are written to the same path (where the later file would overwrite the earlier
+one, or two workers would write the file at once). The first file of every path is still coded.
+
+Returns the number of files that failed.
+*/
+static int mark_duplicate_outputs(Batch *batch) {
+    if (batch->numFiles < 2) {
+        return 0;
+    }
+    OutputEntry *entries = malloc(sizeof(OutputEntry) * batch->numFiles);
+    if (entries == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the batch output paths\n");
+        exit(1);
+    }
+    for (int i = 0; i < batch->numFiles; i++) {
+        entries[i].path = batch->outputPaths[i];
+        entries[i].file = i;
+    }
+    qsort(entries, batch->numFiles, sizeof(OutputEntry), compare_output_entries);
+
+    // The first entry of a run of equal paths is the file that keeps the path
+    int numFailed = 0;
+    int first = 0;
+    for (int i = 1; i < batch->numFiles; i++) {
+        if (strcmp(entries[i].path, entries[first].path) != 0) {
+            first = i;
+            continue;
+        }
+        int file = entries[i].file;
+        fprintf(stderr, "%s: the output file %s is also the output file of %s\n",
+                batch->inputPaths[file], batch->outputPaths[file],
+                batch->inputPaths[entries[first].file]);
+        batch->rets[file] = 2;
+        numFailed++;
+    }
+    free(entries);
+    return numFailed;
+}
+
+/*
+Compress (if <compressing> is true) or decompress each of the <numFiles> files at
+<inputPaths>[i] into the file at <outputPaths>[i], <numThreads> files at a time.
+
+Compressed files are written like encode_file() writes them with <encoding>, <adaptive>,
+<maxLength> and <numStreams>. The encoding is canonicalized and compiled into its encode table
+once, and every file is encoded with that table. Decompressed files are decoded like
+decode_file() decodes them, with <encoding> (which may be NULL) for files in the legacy format.
+
+Every worker thread takes the next file of the list as soon as it is done with its previous
+file, so a few large files do not hold up the rest. Every file is coded on a single thread.
+The first worker runs on this thread, so the batch is still coded if no other thread can be
+started. A file that fails has its error written to standard error with its path and its
+partial output removed, and the other files are still coded. A file with the same output path
+as an earlier file of the list fails without being coded.
+
+The totals of the batch are stored in <stats>.
+
+Returns 0 if every file was coded.
+Returns 1 if <compressing> is true and <encoding> is not valid.
+Otherwise returns the return value of the first file of the list that failed
+(see encode_file() and decode_file()), which is 2 if its output could not be created or is
+the output of an earlier file and 3 if its input could not be opened.
+*/
+int code_batch(char **inputPaths, char **outputPaths, int numFiles, bool compressing,
+               Encoding *encoding, bool adaptive, int maxLength, int numStreams, int numThreads,
+               BatchStats *stats) {
+    double start = coding_clock();
+    *stats = newBatchStats();
+    stats->numFiles = numFiles;
+
+    Batch batch;
+    batch.inputPaths = inputPaths;
+    batch.outputPaths = outputPaths;
+    batch.numFiles = numFiles;
+    batch.compressing = compressing;
+    batch.encoding = encoding;
+    batch.table = NULL;
+    batch.adaptive = adaptive;
+    batch.maxLength = maxLength;
+    batch.numStreams = numStreams;
+    batch.nextFile = 0;
+    batch.stats = stats;
+    batch.rets = calloc(numFiles > 0 ? numFiles : 1, sizeof(int));
+    if (batch.rets == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the batch results\n");
+        exit(1);
+    }
+
+    // The container only stores the encoding lengths so the canonical encodings are used
+    if (compressing) {
+        if (canonicalizeEncoding(encoding) == 0) {
+            batch.table = newEncodeTable(encoding);
+        }
+        if (batch.table == NULL) {
+            free(batch.rets);
+            return 1;
+        }
+    }
+
+    stats->numFailed = mark_duplicate_outputs(&batch);
+
+    int numWorkers = numThreads < numFiles ? numThreads : numFiles;
+    pthread_t *threads = malloc(sizeof(pthread_t) * (numWorkers > 0 ? numWorkers : 1));
+    if (threads == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the batch threads\n");
+        exit(1);
+    }
+    pthread_mutex_init(&batch.lock, NULL);
+    int numStarted = 0;
+    for (int i = 1; i < numWorkers; i++) {
+        if (pthread_create(&threads[i], NULL, batch_worker, &batch) != 0) {
+            break;
+        }
+        numStarted++;
+    }
+    batch_worker(&batch);
+    for (int i = 1; i <= numStarted; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&batch.lock);
+
+    int ret = 0;
+    for (int i = 0; ret == 0 && i < numFiles; i++) {
+        ret = batch.rets[i];
+    }
+
+    if (batch.table != NULL) {
+        destroyEncodeTable(batch.table);
+    }
+    free(threads);
+    free(batch.rets);
+    stats->seconds = coding_clock() - start;
+    return ret;
+}
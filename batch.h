@@ -0,0 +1,61 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "encoding.h"
+
+/*
+The totals of a batch of files coded by code_batch().
+<numFiles> is the number of files in the batch and <numFailed> the number of them that failed.
+<inputBytes> and <outputBytes> are the total sizes of the inputs and outputs of the files that
+were coded, and <seconds> is the wall clock time of the whole batch.
+*/
+typedef struct batchStats {
+    uint64_t numFiles;
+    uint64_t numFailed;
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+    double seconds;
+} BatchStats;
+
+/*
+Initializes and returns new empty batch totals
+*/
+BatchStats newBatchStats();
+
+/*
+Write the totals <stats> of compressing (if <compressing> is true) or decompressing a batch to
+<file>, as a single JSON object if <json> is true and as lines of text otherwise.
+*/
+void print_batch_stats(FILE *file, BatchStats *stats, bool compressing, bool json);
+
+/*
+Compress (if <compressing> is true) or decompress each of the <numFiles> files at
+<inputPaths>[i] into the file at <outputPaths>[i], <numThreads> files at a time.
+
+Compressed files are written like encode_file() writes them with <encoding>, <adaptive>,
+<maxLength> and <numStreams>. The encoding is canonicalized and compiled into its encode table
+once, and every file is encoded with that table. Decompressed files are decoded like
+decode_file() decodes them, with <encoding> (which may be NULL) for files in the legacy format.
+
+Every worker thread takes the next file of the list as soon as it is done with its previous
+file, so a few large files do not hold up the rest. Every file is coded on a single thread.
+A file that fails has its error written to standard error with its path and its partial
+output removed, and the other files are still coded. A file with the same output path as an
+earlier file of the list fails without being coded.
+
+The totals of the batch are stored in <stats>.
+
+Returns 0 if every file was coded.
+Returns 1 if <compressing> is true and <encoding> is not valid.
+Otherwise returns the return value of the first file of the list that failed
+(see encode_file() and decode_file()), which is 2 if its output could not be created or is
+the output of an earlier file and 3 if its input could not be opened.
+*/
+int code_batch(char **inputPaths, char **outputPaths, int numFiles, bool compressing,
+               Encoding *encoding, bool adaptive, int maxLength, int numStreams, int numThreads,
+               BatchStats *stats);
+
+#endif
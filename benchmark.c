@@ -0,0 +1,751 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "encoding.h"
+#include "codec.h"
+#include "compressor.h"
+#include "histogram.h"
+#include "huffman_coding.h"
+#include "priority_queue.h"
+
+// The default size in MiB of every generated corpus
+#define BENCH_DEFAULT_SIZE_MB 8
+// The default number of times every measurement is repeated (the fastest run is reported)
+#define BENCH_DEFAULT_REPEATS 5
+// The seed of the corpus generator, fixed so every run measures the same corpora
+#define BENCH_SEED 0x9E3779B97F4A7C15ULL
+// The number of words in the vocabulary of the generated text
+#define BENCH_VOCABULARY_SIZE 4096
+// The number of encodings built in every timed run of a Huffman tree builder, since a single
+// build of an alphabet of at most MAX_ALPHABET_LEN symbols is too quick to time on its own
+#define BENCH_BUILD_ITERATIONS 1000
+// The number of items the priority queue microbenchmark merges in every timed run, spread over
+// as many queues as it takes
+#define BENCH_QUEUE_WORK (1 << 20)
+// The numbers of items of the queues of the priority queue microbenchmark: a full byte alphabet
+// and the larger queues of other uses of the heap
+#define BENCH_QUEUE_SIZES {256, 4096, 65536}
+
+/*
+A generated corpus.
+<name> describes the kind of data and <data> holds its <len> bytes.
+*/
+typedef struct corpus {
+    char name[MAX_NAME];
+    unsigned char *data;
+    size_t len;
+} Corpus;
+
+/*
+The fastest of a number of timed runs over <bytes> bytes of input.
+*/
+typedef struct timing {
+    double seconds;
+    size_t bytes;
+} Timing;
+
+/*
+Returns the next number of the xorshift64* generator with state <state>.
+*/
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+Returns a random number between 0 and <n> - 1 from the generator with state <state>.
+*/
+static uint64_t random_below(uint64_t *state, uint64_t n) {
+    return next_random(state) % n;
+}
+
+/*
+Returns a random index between 0 and <n> - 1 from the generator with state <state>,
+where index i is drawn with a probability proportional to 1 / (i + 1) (Zipf's law).
+<harmonic> is the sum of 1 / (i + 1) over all n indices.
+*/
+static int random_zipf(uint64_t *state, int n, double harmonic) {
+    double target = (next_random(state) >> 11) * (1.0 / 9007199254740992.0) * harmonic;
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += 1.0 / (i + 1);
+        if (target < sum) {
+            return i;
+        }
+    }
+    return n - 1;
+}
+
+/*
+Returns the sum of 1 / (i + 1) for i from 0 to <n> - 1.
+*/
+static double harmonic_sum(int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += 1.0 / (i + 1);
+    }
+    return sum;
+}
+
+/*
+Allocate the <len> byte buffer of a corpus named <name> and return the corpus.
+*/
+static Corpus newCorpus(const char *name, size_t len) {
+    Corpus corpus;
+    strncpy(corpus.name, name, MAX_NAME - 1);
+    corpus.name[MAX_NAME - 1] = '\0';
+    corpus.len = len;
+    corpus.data = malloc(len > 0 ? len : 1);
+    if (corpus.data == NULL) {
+        fprintf(stderr, "Failed to allocate memory for corpus %s\n", name);
+        exit(1);
+    }
+    return corpus;
+}
+
+/*
+Generate <len> bytes of skewed English-like text: words of a random vocabulary drawn by
+Zipf's law, separated by spaces with the occasional punctuation and line break.
+*/
+static Corpus generate_text(size_t len, uint64_t *state) {
+    Corpus corpus = newCorpus("text", len);
+
+    // Words of 1 to 10 letters with the frequent letters more likely
+    static const char letters[] = "etaoinshrdlcumwfgypbvkjxqz";
+    char words[BENCH_VOCABULARY_SIZE][11];
+    double letterHarmonic = harmonic_sum(26);
+    for (int i = 0; i < BENCH_VOCABULARY_SIZE; i++) {
+        int wordLen = 1 + random_below(state, 10);
+        for (int j = 0; j < wordLen; j++) {
+            words[i][j] = letters[random_zipf(state, 26, letterHarmonic)];
+        }
+        words[i][wordLen] = '\0';
+    }
+
+    double wordHarmonic = harmonic_sum(BENCH_VOCABULARY_SIZE);
+    size_t pos = 0;
+    while (pos < len) {
+        const char *word = words[random_zipf(state, BENCH_VOCABULARY_SIZE, wordHarmonic)];
+        for (int j = 0; word[j] != '\0' && pos < len; j++) {
+            corpus.data[pos++] = word[j];
+        }
+        uint64_t separator = random_below(state, 100);
+        if (pos < len && separator < 5) {
+            corpus.data[pos++] = separator < 4 ? ',' : '.';
+        }
+        if (pos < len) {
+            corpus.data[pos++] = separator == 4 && random_below(state, 4) == 0 ? '\n' : ' ';
+        }
+    }
+    return corpus;
+}
+
+/*
+Generate <len> uniformly random bytes, which cannot be compressed.
+*/
+static Corpus generate_random(size_t len, uint64_t *state) {
+    Corpus corpus = newCorpus("random", len);
+    for (size_t i = 0; i < len; i++) {
+        corpus.data[i] = next_random(state) >> 56;
+    }
+    return corpus;
+}
+
+/*
+Generate <len> bytes of log lines with timestamps, levels, thread names, request ids,
+status codes and latencies.
+*/
+static Corpus generate_log(size_t len, uint64_t *state) {
+    Corpus corpus = newCorpus("log", len);
+    static const char *levels[] = {"INFO", "INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+    static const char *paths[] = {"/api/v1/users", "/api/v1/orders", "/healthz", "/api/v2/search",
+                                  "/static/app.js", "/login"};
+    static const int statuses[] = {200, 200, 200, 200, 201, 204, 301, 404, 500};
+
+    uint64_t millis = 1700000000000ULL;
+    size_t pos = 0;
+    char line[256];
+    while (pos < len) {
+        millis += random_below(state, 50);
+        time_t seconds = millis / 1000;
+        struct tm tm;
+        gmtime_r(&seconds, &tm);
+        int lineLen = snprintf(line, sizeof(line),
+                               "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ %s [worker-%d] %s id=%08llx"
+                               " status=%d latency_ms=%d\n",
+                               tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                               tm.tm_min, tm.tm_sec, (int) (millis % 1000),
+                               levels[random_below(state, 7)], (int) random_below(state, 16),
+                               paths[random_below(state, 6)],
+                               (unsigned long long) (next_random(state) >> 32),
+                               statuses[random_below(state, 9)], (int) random_below(state, 2000));
+        for (int j = 0; j < lineLen && pos < len; j++) {
+            corpus.data[pos++] = line[j];
+        }
+    }
+    return corpus;
+}
+
+/*
+Generate <len> bytes drawn by Zipf's law from an alphabet of the first <alphabetLen> byte values.
+*/
+static Corpus generate_alphabet(size_t len, int alphabetLen, uint64_t *state) {
+    char name[MAX_NAME];
+    snprintf(name, sizeof(name), "alphabet-%d", alphabetLen);
+    Corpus corpus = newCorpus(name, len);
+
+    double harmonic = harmonic_sum(alphabetLen);
+    for (size_t i = 0; i < len; i++) {
+        corpus.data[i] = random_zipf(state, alphabetLen, harmonic);
+    }
+    return corpus;
+}
+
+/*
+Returns the current time in seconds from a monotonic clock.
+*/
+static double now_seconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/*
+Returns a new anonymous temporary file holding the <len> bytes at <data>, rewound to the start.
+Exits if the file cannot be created.
+*/
+static FILE *temp_file_with(const unsigned char *data, size_t len) {
+    FILE *file = tmpfile();
+    if (file == NULL || fwrite(data, 1, len, file) != len || fflush(file) != 0) {
+        fprintf(stderr, "Failed to write a temporary file\n");
+        exit(1);
+    }
+    rewind(file);
+    return file;
+}
+
+/*
+Returns true if the contents of <file> are the <len> bytes at <data>.
+*/
+static bool file_equals(FILE *file, const unsigned char *data, size_t len) {
+    rewind(file);
+    unsigned char buffer[65536];
+    size_t pos = 0;
+    size_t readLen;
+    while ((readLen = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        if (pos + readLen > len || memcmp(buffer, data + pos, readLen) != 0) {
+            return false;
+        }
+        pos += readLen;
+    }
+    return pos == len;
+}
+
+/*
+Write the measurement <name> of <timing> for a corpus of <numSymbols> symbols as a JSON
+object member to <output>.
+*/
+static void print_timing(FILE *output, const char *name, Timing timing, size_t numSymbols,
+                         bool last) {
+    double mbPerSecond = timing.seconds > 0 ? timing.bytes / timing.seconds / 1e6 : 0;
+    double nsPerSymbol = numSymbols > 0 ? timing.seconds * 1e9 / numSymbols : 0;
+    fprintf(output, "      \"%s\": {\"seconds\": %.6f, \"mb_per_s\": %.1f, \"ns_per_symbol\": %.3f}%s\n",
+            name, timing.seconds, mbPerSecond, nsPerSymbol, last ? "" : ",");
+}
+
+/*
+Write the measurement <name> of <timing> for BENCH_BUILD_ITERATIONS builds of an encoding as a
+JSON object member to <output>.
+*/
+static void print_build_timing(FILE *output, const char *name, Timing timing, bool last) {
+    fprintf(output, "      \"%s\": {\"seconds\": %.6f, \"us_per_build\": %.3f}%s\n", name,
+            timing.seconds, timing.seconds * 1e6 / BENCH_BUILD_ITERATIONS, last ? "" : ",");
+}
+
+/*
+Returns the fastest of <repeats> timed runs of building the Huffman encoding of <freqs>
+BENCH_BUILD_ITERATIONS times with <build>, and stores the total encoded size of the symbols of
+<freqs> with the last encoding built in <encodedBits>.
+*/
+static Timing time_builder(Encoding *(*build)(Frequencies, char[MAX_NAME]), Frequencies *freqs,
+                           int repeats, uint64_t *encodedBits) {
+    Timing timing = {1e9, 0};
+    char name[MAX_NAME] = "bench";
+    Encoding *encoding = NULL;
+    for (int i = 0; i < repeats; i++) {
+        double start = now_seconds();
+        for (int j = 0; j < BENCH_BUILD_ITERATIONS; j++) {
+            if (encoding != NULL) {
+                destroyEncoding(encoding);
+            }
+            encoding = build(*freqs, name);
+        }
+        double seconds = now_seconds() - start;
+        timing.seconds = seconds < timing.seconds ? seconds : timing.seconds;
+    }
+
+    *encodedBits = 0;
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        *encodedBits += freqs->frequencies[i] * encoding->lengths[i];
+    }
+    destroyEncoding(encoding);
+    return timing;
+}
+
+/*
+Run the merge loop of the Huffman Coding algorithm on a priority queue with <arity> children per
+heap node: heapify the <numItems> items of <items>, then dequeue the two first items and enqueue
+their merged item until one item is left. Merged items get the tree node indices after the items.
+
+Returns a checksum of the order the items left the queue in, which is the same for every arity,
+and the sum of the merged weights in <mergedWeight>.
+*/
+static uint64_t run_queue(QueueItem *items, int numItems, int arity, uint64_t *mergedWeight) {
+    PriorityQueue *pqueue = newQueue(numItems, arity);
+    heapify(pqueue, items, numItems);
+    uint64_t checksum = 0;
+    *mergedWeight = 0;
+    int nextNode = numItems;
+    while (pqueue->length >= 2) {
+        QueueItem item1 = dequeue(pqueue);
+        QueueItem item2 = dequeue(pqueue);
+        checksum = checksum * 31 + item1.treeNode;
+        checksum = checksum * 31 + item2.treeNode;
+        *mergedWeight += item1.weight + item2.weight;
+        enqueue(pqueue, newQueueItem('\0', item1.weight + item2.weight, nextNode++));
+    }
+    destroyQueue(pqueue);
+    return checksum;
+}
+
+/*
+An item of the priority queue that the d-ary heap of priority_queue.c replaced, kept as the
+baseline of the queue benchmark. The queue was a binary heap over all <maxQueueLength> slots, in
+which removed items were left in place and flagged <empty>, and was ordered by weight alone.
+Its weights were floats; they are the same integers as QueueItem's here, so the merged weights
+of both queues can be compared.
+*/
+typedef struct old_queue_item {
+    unsigned char symbol;
+    uint64_t weight;
+    int empty;
+    int treeNode;
+} OldQueueItem;
+
+/*
+The priority queue that the d-ary heap of priority_queue.c replaced (see OldQueueItem).
+*/
+typedef struct old_priority_queue {
+    OldQueueItem *queue;
+    int maxQueueLength;
+    int length;
+} OldPriorityQueue;
+
+/*
+The enqueue method of the old priority queue: the item is put into the first empty slot, found
+by scanning the slots from the start, and moved up the heap from there.
+
+Returns 0 if successful
+Returns 1 if queue is full
+*/
+static int old_enqueue(OldPriorityQueue *pqueue, OldQueueItem item) {
+    if (pqueue->length == pqueue->maxQueueLength) {
+        return 1;
+    }
+
+    int i = 0;
+    while (i < pqueue->maxQueueLength && !pqueue->queue[i].empty) {
+        i++;
+    }
+    if (i == pqueue->maxQueueLength) {
+        return 1;
+    }
+    pqueue->queue[i] = item;
+
+    while (i > 0) {
+        int parenti = (i - 1) / 2;
+        if (pqueue->queue[parenti].weight <= item.weight) {
+            break;
+        }
+        pqueue->queue[i] = pqueue->queue[parenti];
+        pqueue->queue[parenti] = item;
+        i = parenti;
+    }
+
+    pqueue->length++;
+    return 0;
+}
+
+/*
+The dequeue method of the old priority queue: the lighter child is moved up into the gap left
+by the first item until the gap reaches a slot without nonempty children, where it is left
+empty. The priority queue must be non empty.
+*/
+static OldQueueItem old_dequeue(OldPriorityQueue *pqueue) {
+    OldQueueItem item = pqueue->queue[0];
+    pqueue->length--;
+
+    int i = 0;
+    while (1) {
+        int lchildi = 2 * i + 1;
+        int rchildi = 2 * i + 2;
+        bool lchildEmpty = lchildi >= pqueue->maxQueueLength || pqueue->queue[lchildi].empty;
+        bool rchildEmpty = rchildi >= pqueue->maxQueueLength || pqueue->queue[rchildi].empty;
+        int childi;
+        if (lchildEmpty && rchildEmpty) {
+            break;
+        } else if (rchildEmpty) {
+            childi = lchildi;
+        } else if (lchildEmpty) {
+            childi = rchildi;
+        } else {
+            childi = pqueue->queue[lchildi].weight < pqueue->queue[rchildi].weight ? lchildi
+                                                                                    : rchildi;
+        }
+        pqueue->queue[i] = pqueue->queue[childi];
+        i = childi;
+    }
+    pqueue->queue[i].empty = 1;
+
+    return item;
+}
+
+/*
+Run the merge loop of the Huffman Coding algorithm on the old priority queue, like run_queue():
+enqueue the <numItems> items of <items> one by one, then dequeue the two first items and enqueue
+their merged item until one item is left.
+
+Returns the sum of the merged weights, which is the same for every priority queue.
+*/
+static uint64_t run_old_queue(QueueItem *items, int numItems) {
+    OldPriorityQueue pqueue;
+    pqueue.queue = malloc(sizeof(OldQueueItem) * numItems);
+    if (pqueue.queue == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the old priority queue\n");
+        exit(1);
+    }
+    pqueue.maxQueueLength = numItems;
+    pqueue.length = 0;
+    for (int i = 0; i < numItems; i++) {
+        pqueue.queue[i].empty = 1;
+    }
+
+    for (int i = 0; i < numItems; i++) {
+        OldQueueItem item = {items[i].symbol, items[i].weight, 0, items[i].treeNode};
+        old_enqueue(&pqueue, item);
+    }
+    uint64_t mergedWeight = 0;
+    int nextNode = numItems;
+    while (pqueue.length >= 2) {
+        OldQueueItem item1 = old_dequeue(&pqueue);
+        OldQueueItem item2 = old_dequeue(&pqueue);
+        OldQueueItem merged = {'\0', item1.weight + item2.weight, 0, nextNode++};
+        mergedWeight += merged.weight;
+        old_enqueue(&pqueue, merged);
+    }
+    free(pqueue.queue);
+    return mergedWeight;
+}
+
+/*
+Benchmark the priority queue with binary heap nodes against QUEUE_ARITY children per node and
+against the old priority queue it replaced (see OldPriorityQueue) on the same <numItems> items
+of random weights, and write the results as a JSON object to <output>.
+Every timed run of the d-ary heaps merges BENCH_QUEUE_WORK items (see run_queue()). The old queue
+takes time quadratic in <numItems>, so its timed runs merge 256 / <numItems> as many queues, but
+at least one. The fastest of <repeats> runs is kept.
+
+Returns 0 on success.
+Returns 1 if the arities merged the items in a different order or the old queue's merged
+weights differ.
+*/
+static int bench_queue(FILE *output, int numItems, int repeats, uint64_t *state, bool last) {
+    QueueItem *items = malloc(sizeof(QueueItem) * numItems);
+    if (items == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the queue items\n");
+        exit(1);
+    }
+    for (int i = 0; i < numItems; i++) {
+        items[i] = newQueueItem(i, 1 + random_below(state, 1 << 20), i);
+    }
+
+    int arities[] = {2, QUEUE_ARITY};
+    double seconds[2] = {1e9, 1e9};
+    uint64_t checksums[2];
+    uint64_t mergedWeights[2];
+    int iterations = BENCH_QUEUE_WORK / numItems > 1 ? BENCH_QUEUE_WORK / numItems : 1;
+    for (int a = 0; a < 2; a++) {
+        for (int i = 0; i < repeats; i++) {
+            double start = now_seconds();
+            for (int j = 0; j < iterations; j++) {
+                checksums[a] = run_queue(items, numItems, arities[a], &mergedWeights[a]);
+            }
+            double runSeconds = now_seconds() - start;
+            seconds[a] = runSeconds < seconds[a] ? runSeconds : seconds[a];
+        }
+    }
+
+    double oldSeconds = 1e9;
+    uint64_t oldMergedWeight = 0;
+    int oldIterations = (int) ((int64_t) iterations * 256 / numItems);
+    oldIterations = oldIterations > 1 ? oldIterations : 1;
+    for (int i = 0; i < repeats; i++) {
+        double start = now_seconds();
+        for (int j = 0; j < oldIterations; j++) {
+            oldMergedWeight = run_old_queue(items, numItems);
+        }
+        double runSeconds = now_seconds() - start;
+        oldSeconds = runSeconds < oldSeconds ? runSeconds : oldSeconds;
+    }
+    free(items);
+
+    int ret = 0;
+    if (checksums[0] != checksums[1]) {
+        fprintf(stderr, "The %d-ary heap merged %d items in a different order than the binary "
+                "heap\n", QUEUE_ARITY, numItems);
+        ret = 1;
+    }
+    if (oldMergedWeight != mergedWeights[0] || mergedWeights[0] != mergedWeights[1]) {
+        fprintf(stderr, "The old priority queue merged %d items into different weights than the "
+                "heap\n", numItems);
+        ret = 1;
+    }
+
+    fprintf(output, "    {\"items\": %d, \"ok\": %s", numItems, ret == 0 ? "true" : "false");
+    double oldNsPerItem = oldSeconds * 1e9 / ((double) oldIterations * numItems);
+    fprintf(output, ", \"old_binary\": {\"seconds\": %.6f, \"ns_per_item\": %.3f}", oldSeconds,
+            oldNsPerItem);
+    for (int a = 0; a < 2; a++) {
+        double nsPerItem = seconds[a] * 1e9 / ((double) iterations * numItems);
+        fprintf(output, ", \"arity_%d\": {\"seconds\": %.6f, \"ns_per_item\": %.3f}", arities[a],
+                seconds[a], nsPerItem);
+    }
+    fprintf(output, "}%s\n", last ? "" : ",");
+    return ret;
+}
+
+/*
+Benchmark the corpus <corpus> and write its results as a JSON object to <output>.
+Every measurement is repeated <repeats> times and the fastest run is kept:
+    - generate: counting the symbols of the corpus and generating the Huffman encoding of the
+      counts with generateEncoding()
+    - build_heap and build_two_queue: building the Huffman encoding of the same counts
+      BENCH_BUILD_ITERATIONS times with the heap of generateEncoding() and with the two sorted
+      queues of generateSortedEncoding(), whose encodings must have the same total size
+    - encode: encode_file() from a temporary file holding the corpus
+    - decode: decode_file() of the compressed container back into a temporary file, which is
+      compared with the corpus after every run
+The corpus is compressed with <numStreams> streams per block on <numThreads> threads.
+
+Returns 0 on success.
+Returns 1 if the corpus could not be compressed or did not decompress to itself, or the
+Huffman tree builders disagree.
+*/
+static int bench_corpus(FILE *output, Corpus *corpus, int repeats, int numStreams,
+                        int numThreads, bool last) {
+    FILE *inputFile = temp_file_with(corpus->data, corpus->len);
+    FILE *compressedFile = tmpfile();
+    FILE *decompressedFile = tmpfile();
+    if (compressedFile == NULL || decompressedFile == NULL) {
+        fprintf(stderr, "Failed to create a temporary file\n");
+        exit(1);
+    }
+
+    Timing generate = {1e9, corpus->len};
+    Timing encode = {1e9, corpus->len};
+    Timing decode = {1e9, corpus->len};
+    Encoding *encoding = NULL;
+    char name[MAX_NAME] = "bench";
+    uint64_t counts[HISTOGRAM_SIZE];
+    Frequencies *freqs = NULL;
+    for (int i = 0; i < repeats; i++) {
+        double start = now_seconds();
+        memset(counts, 0, sizeof(counts));
+        count_symbols(corpus->data, corpus->len, counts);
+        Frequencies *counted = newFrequenciesFromCounts(counts, name);
+        Encoding *generated = generateEncoding(*counted, name);
+        double seconds = now_seconds() - start;
+        generate.seconds = seconds < generate.seconds ? seconds : generate.seconds;
+
+        if (freqs != NULL) {
+            destroyFrequencies(freqs);
+            destroyEncoding(encoding);
+        }
+        freqs = counted;
+        encoding = generated;
+    }
+
+    // Both builders build from the same counts
+    uint64_t heapBits;
+    uint64_t twoQueueBits;
+    Timing buildHeap = time_builder(generateEncoding, freqs, repeats, &heapBits);
+    Timing buildTwoQueue = time_builder(generateSortedEncoding, freqs, repeats, &twoQueueBits);
+    destroyFrequencies(freqs);
+
+    int ret = 0;
+    long compressedLen = 0;
+    for (int i = 0; ret == 0 && i < repeats; i++) {
+        rewind(inputFile);
+        if (ftruncate(fileno(compressedFile), 0) != 0) {
+            ret = 1;
+            break;
+        }
+        rewind(compressedFile);
+
+        double start = now_seconds();
+        ret = encode_file(inputFile, compressedFile, encoding, false, 0, numStreams, numThreads,
+                          NULL);
+        fflush(compressedFile);
+        double seconds = now_seconds() - start;
+        encode.seconds = seconds < encode.seconds ? seconds : encode.seconds;
+        compressedLen = ftell(compressedFile);
+    }
+
+    for (int i = 0; ret == 0 && i < repeats; i++) {
+        rewind(compressedFile);
+        if (ftruncate(fileno(decompressedFile), 0) != 0) {
+            ret = 1;
+            break;
+        }
+        rewind(decompressedFile);
+
+        double start = now_seconds();
+        ret = decode_file(compressedFile, decompressedFile, NULL, numThreads, NULL);
+        fflush(decompressedFile);
+        double seconds = now_seconds() - start;
+        decode.seconds = seconds < decode.seconds ? seconds : decode.seconds;
+
+        if (ret == 0 && !file_equals(decompressedFile, corpus->data, corpus->len)) {
+            ret = 1;
+        }
+    }
+    if (ret != 0) {
+        fprintf(stderr, "Corpus %s did not round trip (error %d)\n", corpus->name, ret);
+        ret = 1;
+    }
+    if (heapBits != twoQueueBits) {
+        fprintf(stderr, "Corpus %s encodes to %llu bits with the heap builder but %llu bits with "
+                "the two-queue builder\n", corpus->name, (unsigned long long) heapBits,
+                (unsigned long long) twoQueueBits);
+        ret = 1;
+    }
+
+    fprintf(output, "    {\n");
+    fprintf(output, "      \"name\": \"%s\",\n", corpus->name);
+    fprintf(output, "      \"bytes\": %zu,\n", corpus->len);
+    fprintf(output, "      \"alphabet\": %d,\n", encoding->alphabetlen);
+    fprintf(output, "      \"compressed_bytes\": %ld,\n", compressedLen);
+    fprintf(output, "      \"ratio\": %.4f,\n",
+            corpus->len > 0 ? (double) compressedLen / corpus->len : 0);
+    fprintf(output, "      \"ok\": %s,\n", ret == 0 ? "true" : "false");
+    print_timing(output, "generate", generate, corpus->len, false);
+    print_build_timing(output, "build_heap", buildHeap, false);
+    print_build_timing(output, "build_two_queue", buildTwoQueue, false);
+    print_timing(output, "encode", encode, corpus->len, false);
+    print_timing(output, "decode", decode, corpus->len, true);
+    fprintf(output, "    }%s\n", last ? "" : ",");
+
+    destroyEncoding(encoding);
+    fclose(inputFile);
+    fclose(compressedFile);
+    fclose(decompressedFile);
+    return ret;
+}
+
+/* This program measures the throughput of generating encodings, compressing and decompressing
+on generated corpora, and the speed of the priority queue with binary and QUEUE_ARITY-ary heaps
+and of the old priority queue they replaced on queues of BENCH_QUEUE_SIZES items, and writes the
+results as JSON to standard output
+
+Options:
+    "-s" : The size of every corpus in MiB (default BENCH_DEFAULT_SIZE_MB)
+    "-r" : The number of times every measurement is repeated; the fastest run is reported
+           (default BENCH_DEFAULT_REPEATS)
+    "-m" : Compress every block as CODEC_STREAMS interleaved streams (see encoder -m)
+    "-j" : Compress and decompress this many blocks concurrently (default 1)
+
+Returns 0 if every corpus round tripped and every queue merged the same way with both heaps and
+into the same weights with the old queue, and 1 otherwise.
+*/
+int main(int argc, char **argv) {
+    char *USAGE_STR = "Usage: %s [-s <size_mb>] [-r <repeats>] [-m] [-j <threads>]\n";
+    size_t sizeMb = BENCH_DEFAULT_SIZE_MB;
+    int repeats = BENCH_DEFAULT_REPEATS;
+    int numStreams = 1;
+    int numThreads = 1;
+
+    char opt;
+    opterr = 0;
+    while ((opt = getopt(argc, argv, "s:r:mj:")) != -1) {
+        switch (opt) {
+            case 's':
+                sizeMb = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                repeats = atoi(optarg);
+                break;
+            case 'm':
+                numStreams = CODEC_STREAMS;
+                break;
+            case 'j':
+                numThreads = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, USAGE_STR, argv[0]);
+                return 1;
+        }
+    }
+    if (sizeMb < 1 || repeats < 1 || numThreads < 1) {
+        fprintf(stderr, USAGE_STR, argv[0]);
+        return 1;
+    }
+
+    size_t len = sizeMb << 20;
+    uint64_t state = BENCH_SEED;
+    Corpus corpora[] = {
+        generate_text(len, &state),
+        generate_log(len, &state),
+        generate_random(len, &state),
+        generate_alphabet(len, 2, &state),
+        generate_alphabet(len, 16, &state),
+        generate_alphabet(len, 64, &state),
+    };
+    int numCorpora = sizeof(corpora) / sizeof(corpora[0]);
+
+    printf("{\n");
+    printf("  \"corpus_bytes\": %zu,\n", len);
+    printf("  \"repeats\": %d,\n", repeats);
+    printf("  \"streams\": %d,\n", numStreams);
+    printf("  \"threads\": %d,\n", numThreads);
+    printf("  \"corpora\": [\n");
+    int ret = 0;
+    for (int i = 0; i < numCorpora; i++) {
+        ret |= bench_corpus(stdout, &corpora[i], repeats, numStreams, numThreads,
+                            i == numCorpora - 1);
+        free(corpora[i].data);
+    }
+    printf("  ],\n");
+
+    static const int queueSizes[] = BENCH_QUEUE_SIZES;
+    int numQueueSizes = sizeof(queueSizes) / sizeof(queueSizes[0]);
+    printf("  \"queue\": [\n");
+    for (int i = 0; i < numQueueSizes; i++) {
+        ret |= bench_queue(stdout, queueSizes[i], repeats, &state, i == numQueueSizes - 1);
+    }
+    printf("  ],\n");
+
+    // ru_maxrss is in KiB on Linux
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("  \"peak_rss_kb\": %ld\n", usage.ru_maxrss);
+    printf("}\n");
+    return ret;
+}
@@ -0,0 +1,185 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+Bitstreams are written and read least significant bit first: the first bit of the stream
+is the lowest bit of its first byte, and a code of n bits is stored with its first bit as
+the lowest bit of the integer (see EncodeEntry).
+
+All of the functions are defined here so they are inlined into the encode and decode loops.
+This also keeps the readers and writers of those loops in registers, which a call to a
+function that is passed their address would prevent.
+*/
+
+// The number of bytes past the end of the written bits that flush_bits() may overwrite
+#define BIT_WRITER_SLACK 8
+
+/*
+A reader of the bitstream held in the <inputLen> bytes at <input>.
+<inputPos> is the index of the next byte of <input> that has not been read into <bitBuffer>.
+<bitBuffer> holds the <bitCount> bits that have been read but not consumed yet, with the next
+bit of the stream as the lowest bit. The bits above them are either 0 or the first bits of
+the byte at <inputPos>, which refilling ORs in again at the same position.
+*/
+typedef struct bit_reader {
+    const unsigned char *input;
+    size_t inputLen;
+    size_t inputPos;
+    uint64_t bitBuffer;
+    int bitCount;
+} BitReader;
+
+/*
+A writer of a bitstream into <output>.
+<outputPos> is the number of whole bytes written to <output>.
+<bitBuffer> holds the <bitCount> bits that have been put but not written as a whole byte yet,
+with the first of them as the lowest bit. The bits above them are 0.
+*/
+typedef struct bit_writer {
+    unsigned char *output;
+    size_t outputPos;
+    uint64_t bitBuffer;
+    int bitCount;
+} BitWriter;
+
+/*
+Returns the 8 bytes at <bytes> as a little-endian integer.
+(Compilers turn this into a single load on little-endian machines.)
+*/
+static inline uint64_t load_le64(const unsigned char *bytes) {
+    return (uint64_t) bytes[0] | (uint64_t) bytes[1] << 8 | (uint64_t) bytes[2] << 16
+           | (uint64_t) bytes[3] << 24 | (uint64_t) bytes[4] << 32 | (uint64_t) bytes[5] << 40
+           | (uint64_t) bytes[6] << 48 | (uint64_t) bytes[7] << 56;
+}
+
+/*
+Store <value> as a little-endian integer in the 8 bytes at <bytes>.
+*/
+static inline void store_le64(unsigned char *bytes, uint64_t value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(bytes, &value, sizeof(value));
+#else
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = value >> (8 * i);
+    }
+#endif
+}
+
+/*
+Initializes and returns a new BitReader at the start of the <inputLen> bytes at <input>
+*/
+static inline BitReader newBitReader(const unsigned char *input, size_t inputLen) {
+    BitReader reader;
+    reader.input = input;
+    reader.inputLen = inputLen;
+    reader.inputPos = 0;
+    reader.bitBuffer = 0;
+    reader.bitCount = 0;
+    return reader;
+}
+
+/*
+Initializes and returns a new BitWriter at the start of <output>
+*/
+static inline BitWriter newBitWriter(unsigned char *output) {
+    BitWriter writer;
+    writer.output = output;
+    writer.outputPos = 0;
+    writer.bitBuffer = 0;
+    writer.bitCount = 0;
+    return writer;
+}
+
+/*
+Fill the bit buffer of <reader>, which must have at least 8 bytes of input left, so it holds
+at least 56 bits. Used by refill_bits() and by loops that have already made sure enough input
+is left for all of their refills.
+*/
+static inline void refill_bits_fast(BitReader *reader) {
+    reader->bitBuffer |= load_le64(reader->input + reader->inputPos) << reader->bitCount;
+    reader->inputPos += (63 - reader->bitCount) >> 3;
+    reader->bitCount |= 56;
+}
+
+/*
+Fill the bit buffer of <reader> so it holds at least 56 bits (if the input has them).
+
+With at least 8 bytes of input left, the next 8 bytes are loaded as a single word and as many
+whole bytes as fit are kept, without a branch per byte. The bytes that did not fit are loaded
+again by the next refill.
+*/
+static inline void refill_bits(BitReader *reader) {
+    if (reader->inputLen - reader->inputPos >= 8) {
+        refill_bits_fast(reader);
+    } else {
+        // Near the end of the input the bytes are read one at a time
+        while (reader->bitCount <= 56 && reader->inputPos < reader->inputLen) {
+            reader->bitBuffer |= (uint64_t) reader->input[reader->inputPos++] << reader->bitCount;
+            reader->bitCount += 8;
+        }
+    }
+}
+
+/*
+Returns the next <numBits> (at most 63) bits of <reader> without consuming them, with the
+next bit of the stream as the lowest bit. Only the first bitCount of them have been read.
+*/
+static inline uint64_t peek_bits(const BitReader *reader, int numBits) {
+    return reader->bitBuffer & ((1ULL << numBits) - 1);
+}
+
+/*
+Consume the next <numBits> bits of <reader>, which must be in its bit buffer.
+*/
+static inline void consume_bits(BitReader *reader, int numBits) {
+    reader->bitBuffer >>= numBits;
+    reader->bitCount -= numBits;
+}
+
+/*
+Add the <length> lowest bits of <code> to the stream of <writer>, first bit lowest.
+At most 56 bits can be put between calls to flush_bits().
+*/
+static inline void put_bits(BitWriter *writer, uint32_t code, int length) {
+    writer->bitBuffer |= (uint64_t) code << writer->bitCount;
+    writer->bitCount += length;
+}
+
+/*
+Write the whole bytes in the bit buffer of <writer> to its output, leaving at most 7 bits
+in the bit buffer.
+
+The whole bit buffer is stored as a single word and the output position is moved past the
+whole bytes only, so up to BIT_WRITER_SLACK bytes after them are overwritten. The bytes past
+the whole bytes are written again by the next flush.
+*/
+static inline void flush_bits(BitWriter *writer) {
+    store_le64(writer->output + writer->outputPos, writer->bitBuffer);
+    int numBytes = writer->bitCount >> 3;
+    writer->outputPos += numBytes;
+    writer->bitBuffer >>= 8 * numBytes;
+    writer->bitCount &= 7;
+}
+
+/*
+Write the bits left in the bit buffer of <writer> to its output, padding the last byte
+with zeros.
+
+Returns the total number of bytes written to the output of <writer>.
+*/
+static inline size_t finish_bits(BitWriter *writer) {
+    while (writer->bitCount > 0) {
+        writer->output[writer->outputPos++] = writer->bitBuffer;
+        writer->bitBuffer >>= 8;
+        writer->bitCount -= 8;
+    }
+    writer->bitBuffer = 0;
+    writer->bitCount = 0;
+    return writer->outputPos;
+}
+
+#endif
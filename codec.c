@@ -0,0 +1,340 @@
+#include <stdint.h>
+#include "codec.h"
+
+/*
+Encode the <inputLen> symbols at <input> with the encode table <table> into <output>.
+<output> must hold at least ENCODE_BOUND(inputLen) bytes.
+The bits of the last output byte that are not part of an encoding are set to 0.
+
+Encoded bits are gathered by a BitWriter, which writes out the whole bytes of its bit buffer
+after every symbol with a single word store.
+
+Returns the number of bytes written to <output> on success.
+Returns -1 if a symbol that is not in the encoding alphabet is encountered.
+*/
+long encode_block(const EncodeTable *table, const unsigned char *input, size_t inputLen,
+                  unsigned char *output) {
+    const EncodeEntry *entries = table->entries;
+    BitWriter writer = newBitWriter(output);
+
+    for (size_t i = 0; i < inputLen; i++) {
+        EncodeEntry entry = entries[input[i]];
+        if (entry.length == 0) {
+            // Did not find the symbol in the alphabet
+            return -1;
+        }
+
+        put_bits(&writer, entry.code, entry.length);
+        flush_bits(&writer);
+    }
+
+    // Write out the remaining bits, padding the last byte with zeros
+    return finish_bits(&writer);
+}
+
+/*
+Initializes and returns a new Decoder for a stream of <numBits> bits encoded with <table>
+*/
+Decoder newDecoder(const DecodeTable *table, uint64_t numBits) {
+    Decoder decoder;
+    decoder.table = table;
+    decoder.reader = newBitReader(NULL, 0);
+    decoder.bitsLeft = numBits;
+    return decoder;
+}
+
+/*
+Helper for decode_bits().
+Returns the decode table entry in <entries> for the encoding at the start of the bit buffer
+of <reader>, following links to secondary tables. The entry has no symbols if no encoding
+starts with those bits.
+*/
+static inline DecodeEntry lookup_entry(const DecodeEntry *entries, const BitReader *reader) {
+    DecodeEntry entry = entries[peek_bits(reader, DECODE_TABLE_BITS)];
+    if (entry.numSymbols == 0 && entry.numBits != 0) {
+        // Encodings longer than DECODE_TABLE_BITS bits are looked up in a secondary table
+        uint64_t subIndex = peek_bits(reader, DECODE_TABLE_BITS + entry.numBits) >> DECODE_TABLE_BITS;
+        entry = entries[entry.value + subIndex];
+    }
+    return entry;
+}
+
+/*
+Helper for decode_block_streams().
+Refill <reader> (which must have at least 8 bytes of input left) and decode the entry at the start of its bit buffer into <output> at
+<outputPos>, which must have room for DECODE_MAX_SYMBOLS symbols. <outputPos> is moved past
+the decoded symbols.
+
+Returns 0 on success.
+Returns 1 if no encoding starts with the bits of <reader>.
+*/
+static inline int decode_entry(const DecodeEntry *entries, BitReader *reader,
+                               unsigned char *output, size_t *outputPos) {
+    refill_bits_fast(reader);
+    DecodeEntry entry = lookup_entry(entries, reader);
+    output[*outputPos] = entry.value;
+    output[*outputPos + 1] = entry.value >> 8;
+    *outputPos += entry.numSymbols;
+    consume_bits(reader, entry.numBits);
+    return entry.numSymbols == 0;
+}
+
+/*
+Decode the stream of <decoder>, continuing from where the last call left off, into the
+<outputLen> bytes at <output>. <input> holds the next <inputLen> bytes of the stream and
+<inputUsed> is set to the number of them that were read into the decoder.
+
+Up to DECODE_MAX_SYMBOLS symbols are decoded per table lookup from the 64-bit bit buffer of
+a BitReader. The reader is only given the bytes of <input> that are part of the stream, and an
+encoding is only looked up once MAX_ENC_SIZE_BITS bits (or the rest of the stream) are
+buffered, so a stream split anywhere decodes the same.
+While at least 8 bytes of input are left, every refill buffers at least 56 bits of the stream,
+so that part is decoded by a loop without the checks for the ends of the input and stream.
+
+Returns the number of symbols written to <output> on success.
+Returns -1 if an encoding that is not in the encoding alphabet is encountered or the stream
+ends in the middle of an encoding.
+*/
+long decode_bits(Decoder *decoder, const unsigned char *input, size_t inputLen,
+                 size_t *inputUsed, unsigned char *output, size_t outputLen) {
+    const DecodeEntry *entries = decoder->table->entries;
+    // The decoder state is kept in locals while decoding and stored back at the end
+    BitReader reader = decoder->reader;
+    uint64_t bitsLeft = decoder->bitsLeft;
+    size_t outputPos = 0;
+    int failed = 0;
+
+    // Only give the reader the bytes of the stream that it has not buffered yet
+    uint64_t unreadBits = bitsLeft > (uint64_t) reader.bitCount ? bitsLeft - reader.bitCount : 0;
+    uint64_t unreadBytes = (unreadBits + 7) / 8;
+    reader.input = input;
+    reader.inputLen = inputLen < unreadBytes ? inputLen : unreadBytes;
+    reader.inputPos = 0;
+
+    int startBitCount = reader.bitCount;
+    while (reader.inputLen - reader.inputPos >= 8 && outputLen - outputPos >= DECODE_MAX_SYMBOLS) {
+        refill_bits(&reader);
+
+        DecodeEntry entry = lookup_entry(entries, &reader);
+        if (entry.numSymbols == 0) {
+            failed = 1;
+            break;
+        }
+        output[outputPos] = entry.value;
+        output[outputPos + 1] = entry.value >> 8;
+        outputPos += entry.numSymbols;
+        consume_bits(&reader, entry.numBits);
+    }
+    // Account for the bits decoded above all at once
+    bitsLeft -= 8 * reader.inputPos + startBitCount - reader.bitCount;
+
+    while (!failed && outputPos < outputLen && bitsLeft > 0) {
+        refill_bits(&reader);
+        // The buffered bits that are part of the stream (the last byte may hold padding)
+        int available = (uint64_t) reader.bitCount < bitsLeft ? reader.bitCount : (int) bitsLeft;
+        if (available < MAX_ENC_SIZE_BITS && (uint64_t) available < bitsLeft) {
+            // The next encoding may continue in input that has not been given yet
+            break;
+        }
+
+        DecodeEntry entry = lookup_entry(entries, &reader);
+        if (entry.numSymbols == 0) {
+            failed = 1;
+            break;
+        }
+
+        if (entry.numSymbols == 2 && entry.numBits <= available && outputPos + 1 < outputLen) {
+            output[outputPos] = entry.value;
+            output[outputPos + 1] = entry.value >> 8;
+            outputPos += 2;
+        } else if (entry.firstBits <= available) {
+            // Only the first symbol of the entry is needed (or part of the stream)
+            output[outputPos++] = entry.value;
+            entry.numBits = entry.firstBits;
+        } else {
+            // The stream ended in the middle of an encoding
+            failed = 1;
+            break;
+        }
+        consume_bits(&reader, entry.numBits);
+        bitsLeft -= entry.numBits;
+    }
+
+    decoder->reader = reader;
+    decoder->bitsLeft = bitsLeft;
+    *inputUsed = reader.inputPos;
+    return failed ? -1 : (long) outputPos;
+}
+
+/*
+Decode exactly <outputLen> symbols from the <inputLen> encoded bytes at <input>
+with the decode table <table> into <output>.
+
+The block is decoded as a single piece by a Decoder (see decode_bits()). The bits of the
+last input byte that follow the last symbol are ignored.
+
+Returns 0 on success.
+Returns 1 if an encoding that is not in the encoding alphabet is encountered or the
+input ends before <outputLen> symbols are decoded.
+*/
+int decode_block(const DecodeTable *table, const unsigned char *input, size_t inputLen,
+                 unsigned char *output, size_t outputLen) {
+    Decoder decoder = newDecoder(table, (uint64_t) inputLen * 8);
+    size_t inputUsed;
+    long decoded = decode_bits(&decoder, input, inputLen, &inputUsed, output, outputLen);
+    return decoded >= 0 && (size_t) decoded == outputLen ? 0 : 1;
+}
+
+/*
+Encode the <inputLen> symbols at <input> with the encode table <table> into <output> as
+<numStreams> (1 or CODEC_STREAMS) interleaved streams.
+<output> must hold at least ENCODE_BOUND(inputLen) bytes.
+
+The symbols are split into <numStreams> segments of (inputLen + numStreams - 1) / numStreams
+symbols (the last segments may be shorter or empty), each encoded as a stream of its own by
+encode_block(). The output is the CODEC_JUMP_TABLE_SIZE(numStreams) byte jump table holding the
+4 byte little-endian size of every stream but the last, followed by the streams in order.
+A single stream has no jump table and is the same as the output of encode_block().
+
+The bit buffer flushes of a stream may overwrite the start of the next stream's space, so the
+streams are encoded in order.
+
+Returns the number of bytes written to <output> on success.
+Returns -1 if a symbol that is not in the encoding alphabet is encountered.
+*/
+long encode_block_streams(const EncodeTable *table, const unsigned char *input, size_t inputLen,
+                          int numStreams, unsigned char *output) {
+    size_t segmentLen = (inputLen + numStreams - 1) / numStreams;
+    long outputPos = CODEC_JUMP_TABLE_SIZE(numStreams);
+
+    for (int i = 0; i < numStreams; i++) {
+        size_t start = i * segmentLen < inputLen ? i * segmentLen : inputLen;
+        size_t len = inputLen - start < segmentLen ? inputLen - start : segmentLen;
+        long streamLen = encode_block(table, input + start, len, output + outputPos);
+        if (streamLen < 0) {
+            return -1;
+        }
+
+        if (i < numStreams - 1) {
+            for (int j = 0; j < 4; j++) {
+                output[4 * i + j] = (uint64_t) streamLen >> (8 * j);
+            }
+        }
+        outputPos += streamLen;
+    }
+
+    return outputPos;
+}
+
+/*
+Decode exactly <outputLen> symbols from the <inputLen> bytes at <input> written by
+encode_block_streams() with <numStreams> (1 or CODEC_STREAMS) streams, with the decode table
+<table> into <output>.
+
+The CODEC_STREAMS streams of a block are decoded together by one loop that advances a separate
+BitReader for each of them. The lookups of the streams do not depend on each other, so they
+overlap instead of each waiting for the previous one to finish. Once a stream is within 8 bytes
+of its end or its segment is almost full, the rest of every stream is decoded on its own by a
+Decoder picking up from that stream's reader (see decode_bits()).
+
+Returns 0 on success.
+Returns 1 if an encoding that is not in the encoding alphabet is encountered, the jump table
+is invalid or a stream ends before its symbols are decoded.
+*/
+int decode_block_streams(const DecodeTable *table, const unsigned char *input, size_t inputLen,
+                         int numStreams, unsigned char *output, size_t outputLen) {
+    if (numStreams == 1) {
+        return decode_block(table, input, inputLen, output, outputLen);
+    }
+    if (numStreams != CODEC_STREAMS || inputLen < CODEC_JUMP_TABLE_SIZE(CODEC_STREAMS)) {
+        return 1;
+    }
+
+    // Find the streams from the jump table and their segments of the output
+    const DecodeEntry *entries = table->entries;
+    size_t segmentLen = (outputLen + CODEC_STREAMS - 1) / CODEC_STREAMS;
+    BitReader readers[CODEC_STREAMS];
+    size_t outputPos[CODEC_STREAMS];
+    size_t outputEnd[CODEC_STREAMS];
+    size_t inputPos = CODEC_JUMP_TABLE_SIZE(CODEC_STREAMS);
+    for (int i = 0; i < CODEC_STREAMS; i++) {
+        size_t streamLen = inputLen - inputPos;
+        if (i < CODEC_STREAMS - 1) {
+            streamLen = (size_t) input[4 * i] | (size_t) input[4 * i + 1] << 8
+                        | (size_t) input[4 * i + 2] << 16 | (size_t) input[4 * i + 3] << 24;
+            if (streamLen > inputLen - inputPos) {
+                return 1;
+            }
+        }
+        readers[i] = newBitReader(input + inputPos, streamLen);
+        inputPos += streamLen;
+
+        outputPos[i] = i * segmentLen < outputLen ? i * segmentLen : outputLen;
+        outputEnd[i] = outputLen - outputPos[i] < segmentLen ? outputLen : outputPos[i] + segmentLen;
+    }
+
+    // Decode the streams together in runs of rounds that need no checks for the ends of the
+    // streams or segments. A round consumes at most MAX_ENC_SIZE_BYTES bytes of every stream and
+    // a reader is at most 7 bytes ahead of its consumed bits, so a stream with <left> bytes left
+    // has 8 bytes to load for the refills of the next (left - 15) / MAX_ENC_SIZE_BYTES + 1 rounds.
+    // The readers are copied to locals for the run so they stay in registers.
+    for (;;) {
+        size_t rounds = SIZE_MAX;
+        for (int i = 0; i < CODEC_STREAMS; i++) {
+            size_t left = readers[i].inputLen - readers[i].inputPos;
+            size_t inputRounds = left >= 15 ? (left - 15) / MAX_ENC_SIZE_BYTES + 1 : 0;
+            size_t outputRounds = (outputEnd[i] - outputPos[i]) / DECODE_MAX_SYMBOLS;
+            rounds = inputRounds < rounds ? inputRounds : rounds;
+            rounds = outputRounds < rounds ? outputRounds : rounds;
+        }
+        if (rounds == 0) {
+            break;
+        }
+
+        BitReader reader0 = readers[0];
+        BitReader reader1 = readers[1];
+        BitReader reader2 = readers[2];
+        BitReader reader3 = readers[3];
+        size_t pos0 = outputPos[0];
+        size_t pos1 = outputPos[1];
+        size_t pos2 = outputPos[2];
+        size_t pos3 = outputPos[3];
+        int failed = 0;
+        for (size_t r = 0; r < rounds; r++) {
+            failed |= decode_entry(entries, &reader0, output, &pos0);
+            failed |= decode_entry(entries, &reader1, output, &pos1);
+            failed |= decode_entry(entries, &reader2, output, &pos2);
+            failed |= decode_entry(entries, &reader3, output, &pos3);
+        }
+        if (failed) {
+            return 1;
+        }
+        readers[0] = reader0;
+        readers[1] = reader1;
+        readers[2] = reader2;
+        readers[3] = reader3;
+        outputPos[0] = pos0;
+        outputPos[1] = pos1;
+        outputPos[2] = pos2;
+        outputPos[3] = pos3;
+    }
+
+    // Decode the rest of every stream on its own
+    for (int i = 0; i < CODEC_STREAMS; i++) {
+        BitReader *reader = &readers[i];
+        size_t unread = reader->inputLen - reader->inputPos;
+        Decoder decoder = newDecoder(table, 8 * (uint64_t) unread + reader->bitCount);
+        decoder.reader.bitBuffer = reader->bitBuffer;
+        decoder.reader.bitCount = reader->bitCount;
+
+        size_t inputUsed;
+        size_t left = outputEnd[i] - outputPos[i];
+        long decoded = decode_bits(&decoder, reader->input + reader->inputPos, unread, &inputUsed,
+                                   output + outputPos[i], left);
+        if (decoded < 0 || (size_t) decoded != left) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bitstream.h"
+#include "encoding.h"
+#include "encode_table.h"
+#include "decode_table.h"
+
+// The number of interleaved streams a block is split into by encode_block_streams()
+#define CODEC_STREAMS 4
+// The size of the jump table in front of a block of <numStreams> streams: the 4 byte size of
+// every stream but the last
+#define CODEC_JUMP_TABLE_SIZE(numStreams) (4 * ((numStreams) - 1))
+
+// The number of bytes needed to hold the encoded bits of <numSymbols> symbols in up to
+// CODEC_STREAMS streams (every encoding is at most MAX_ENC_SIZE_BYTES bytes, plus the jump table
+// and room for a whole bit buffer flush)
+#define ENCODE_BOUND(numSymbols) \
+    ((numSymbols) * MAX_ENC_SIZE_BYTES + CODEC_JUMP_TABLE_SIZE(CODEC_STREAMS) + BIT_WRITER_SLACK)
+
+/*
+Encode the <inputLen> symbols at <input> with the encode table <table> into <output>.
+<output> must hold at least ENCODE_BOUND(inputLen) bytes.
+The bits of the last output byte that are not part of an encoding are set to 0.
+
+Returns the number of bytes written to <output> on success.
+Returns -1 if a symbol that is not in the encoding alphabet is encountered.
+*/
+long encode_block(const EncodeTable *table, const unsigned char *input, size_t inputLen,
+                  unsigned char *output);
+
+/*
+Encode the <inputLen> symbols at <input> with the encode table <table> into <output> as
+<numStreams> (1 or CODEC_STREAMS) interleaved streams.
+<output> must hold at least ENCODE_BOUND(inputLen) bytes.
+
+The symbols are split into <numStreams> segments of (inputLen + numStreams - 1) / numStreams
+symbols (the last segments may be shorter or empty), each encoded as a stream of its own by
+encode_block(). The output is the CODEC_JUMP_TABLE_SIZE(numStreams) byte jump table holding the
+4 byte little-endian size of every stream but the last, followed by the streams in order.
+A single stream has no jump table and is the same as the output of encode_block().
+
+Returns the number of bytes written to <output> on success.
+Returns -1 if a symbol that is not in the encoding alphabet is encountered.
+*/
+long encode_block_streams(const EncodeTable *table, const unsigned char *input, size_t inputLen,
+                          int numStreams, unsigned char *output);
+
+/*
+The state of a decoder reading a single bitstream, which may be handed to decode_bits()
+in any number of pieces.
+<table> is the decode table the stream is decoded with. It is never modified, so any number of
+decoders (on any number of threads) can share one table.
+<reader> holds the bits that have been read from the stream but not decoded yet in its bit
+buffer. Its input is replaced by the input of every call to decode_bits().
+<bitsLeft> is the number of bits of the stream that have not been decoded yet (including the
+bits in the bit buffer of <reader>).
+*/
+typedef struct decoder {
+    const DecodeTable *table;
+    BitReader reader;
+    uint64_t bitsLeft;
+} Decoder;
+
+/*
+Initializes and returns a new Decoder for a stream of <numBits> bits encoded with <table>
+*/
+Decoder newDecoder(const DecodeTable *table, uint64_t numBits);
+
+/*
+Decode the stream of <decoder>, continuing from where the last call left off, into the
+<outputLen> bytes at <output>. <input> holds the next <inputLen> bytes of the stream and
+<inputUsed> is set to the number of them that were read into the decoder.
+
+Decoding stops when <output> is full, the stream has been decoded, or <input> runs out
+before the next encoding can be decoded. Call again with the rest of the stream to continue.
+
+Returns the number of symbols written to <output> on success.
+Returns -1 if an encoding that is not in the encoding alphabet is encountered or the stream
+ends in the middle of an encoding.
+*/
+long decode_bits(Decoder *decoder, const unsigned char *input, size_t inputLen,
+                 size_t *inputUsed, unsigned char *output, size_t outputLen);
+
+/*
+Decode exactly <outputLen> symbols from the <inputLen> encoded bytes at <input>
+with the decode table <table> into <output>.
+
+Returns 0 on success.
+Returns 1 if an encoding that is not in the encoding alphabet is encountered or the
+input ends before <outputLen> symbols are decoded.
+*/
+int decode_block(const DecodeTable *table, const unsigned char *input, size_t inputLen,
+                 unsigned char *output, size_t outputLen);
+
+/*
+Decode exactly <outputLen> symbols from the <inputLen> bytes at <input> written by
+encode_block_streams() with <numStreams> (1 or CODEC_STREAMS) streams, with the decode table
+<table> into <output>.
+
+Returns 0 on success.
+Returns 1 if an encoding that is not in the encoding alphabet is encountered, the jump table
+is invalid or a stream ends before its symbols are decoded.
+*/
+int decode_block_streams(const DecodeTable *table, const unsigned char *input, size_t inputLen,
+                         int numStreams, unsigned char *output, size_t outputLen);
+
+#endif
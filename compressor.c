@@ -0,0 +1,1101 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "compressor.h"
+#include "encoding.h"
+#include "encode_table.h"
+#include "decode_table.h"
+#include "codec.h"
+#include "container.h"
+#include "histogram.h"
+#include "huffman_coding.h"
+
+// The size in bytes of the buffers used to read and write files
+#define IO_BUFFER_SIZE 65536
+// When compressing adaptively, a block only gets its own table if that makes the block
+// (including the table) at least 1/ADAPTIVE_MIN_GAIN smaller than with the previous table
+#define ADAPTIVE_MIN_GAIN 100
+
+/*
+Initializes and returns new empty statistics
+*/
+CodingStats newCodingStats() {
+    CodingStats stats;
+    memset(&stats, 0, sizeof(stats));
+    return stats;
+}
+
+/*
+Returns the current time in seconds from a monotonic clock.
+*/
+double coding_clock() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/*
+Helper to return the time a phase timed by end_phase() starts at, if <stats> is not NULL.
+*/
+static double start_phase(CodingStats *stats) {
+    return stats != NULL ? coding_clock() : 0;
+}
+
+/*
+Helper to add the time since <*mark> to the <phase> of <stats> and move <*mark> to now,
+where the next phase starts. Does nothing if <stats> is NULL.
+*/
+static void end_phase(CodingStats *stats, CodingPhase phase, double *mark) {
+    if (stats != NULL) {
+        double now = coding_clock();
+        stats->seconds[phase] += now - *mark;
+        *mark = now;
+    }
+}
+
+/*
+Helper to add the <len> uncompressed symbols at <data> to the symbol counts of <stats>
+if <stats> is not NULL.
+*/
+static void count_stats_symbols(CodingStats *stats, const unsigned char *data, size_t len) {
+    if (stats != NULL) {
+        stats->symbols += len;
+        count_symbols(data, len, stats->counts);
+    }
+}
+
+/*
+Write <stats> of compressing (if <compressing> is true) or decompressing a file to <file>,
+as a single JSON object if <json> is true and as lines of text otherwise.
+
+Besides the collected statistics this reports:
+    - the compression ratio: the compressed size divided by the uncompressed size
+    - the entropy of the symbol counts in bits per symbol, the smallest average number of bits
+      any code for symbols with these frequencies can use
+    - the average code length: the encoded streams in bits per symbol
+    - the bits per symbol of the whole compressed file (including the container overhead)
+*/
+void print_coding_stats(FILE *file, CodingStats *stats, bool compressing, bool json) {
+    static const char *phaseNames[CODING_NUM_PHASES] = {"load", "read", "code", "write", "stats"};
+    uint64_t compressedBytes = compressing ? stats->outputBytes : stats->inputBytes;
+    uint64_t uncompressedBytes = compressing ? stats->inputBytes : stats->outputBytes;
+    double ratio = uncompressedBytes > 0 ? (double) compressedBytes / uncompressedBytes : 0;
+
+    double entropy = 0;
+    double averageCodeLength = 0;
+    double bitsPerSymbol = 0;
+    if (stats->symbols > 0) {
+        for (int i = 0; i < 256; i++) {
+            if (stats->counts[i] > 0) {
+                double p = (double) stats->counts[i] / stats->symbols;
+                entropy -= p * log2(p);
+            }
+        }
+        averageCodeLength = stats->payloadBytes * 8.0 / stats->symbols;
+        bitsPerSymbol = compressedBytes * 8.0 / stats->symbols;
+    }
+    double codeSeconds = stats->seconds[CODING_PHASE_CODE];
+    double codeMbPerSecond = codeSeconds > 0 ? stats->symbols / codeSeconds / 1e6 : 0;
+
+    if (json) {
+        fprintf(file, "{\"mode\": \"%s\", \"seconds\": {", compressing ? "compress" : "decompress");
+        for (int i = 0; i < CODING_NUM_PHASES; i++) {
+            fprintf(file, "%s\"%s\": %.6f", i > 0 ? ", " : "", phaseNames[i], stats->seconds[i]);
+        }
+        fprintf(file, "}, \"input_bytes\": %llu, \"output_bytes\": %llu, \"symbols\": %llu,"
+                      " \"payload_bytes\": %llu, \"ratio\": %.6f, \"entropy_bits\": %.6f,"
+                      " \"average_code_bits\": %.6f, \"bits_per_symbol\": %.6f,"
+                      " \"code_mb_per_s\": %.1f}\n",
+                (unsigned long long) stats->inputBytes, (unsigned long long) stats->outputBytes,
+                (unsigned long long) stats->symbols, (unsigned long long) stats->payloadBytes,
+                ratio, entropy, averageCodeLength, bitsPerSymbol, codeMbPerSecond);
+        return;
+    }
+
+    for (int i = 0; i < CODING_NUM_PHASES; i++) {
+        fprintf(file, "%-18s %.6f s\n", phaseNames[i], stats->seconds[i]);
+    }
+    fprintf(file, "%-18s %llu bytes\n", "input", (unsigned long long) stats->inputBytes);
+    fprintf(file, "%-18s %llu bytes\n", "output", (unsigned long long) stats->outputBytes);
+    fprintf(file, "%-18s %.4f\n", "ratio", ratio);
+    fprintf(file, "%-18s %llu\n", "symbols", (unsigned long long) stats->symbols);
+    fprintf(file, "%-18s %.4f bits/symbol\n", "entropy", entropy);
+    fprintf(file, "%-18s %.4f bits/symbol\n", "average code", averageCodeLength);
+    fprintf(file, "%-18s %.4f bits/symbol\n", "file", bitsPerSymbol);
+    fprintf(file, "%-18s %.1f MB/s\n", "coding speed", codeMbPerSecond);
+}
+
+/*
+Returns the description of the error <ret> returned by compressing (if <compressing> is true)
+or decompressing a file with encode_file(), decode_file() or the functions they use.
+*/
+const char *coding_error(int ret, bool compressing) {
+    switch (ret) {
+        case 1:
+            return compressing ? "a character is not in the encoding alphabet"
+                               : "an encoded character is not in the encoding alphabet";
+        case 2:
+            return "error writing the output file";
+        case 3:
+            return compressing ? "error reading the input file"
+                               : "error reading the input file or it is not a valid container";
+        case 4:
+            return "the file is in the legacy format and needs its encoding file (-e)";
+        default:
+            return "unknown error";
+    }
+}
+
+/*
+Returns true if <file> is a regular file (which can be memory mapped and seeked)
+and false otherwise (like for a pipe or terminal).
+*/
+bool is_regular_file(FILE *file) {
+    struct stat fileStat;
+    return fstat(fileno(file), &fileStat) == 0 && S_ISREG(fileStat.st_mode);
+}
+
+/*
+Map the whole of <file> into memory read-only and store its size in <size>.
+
+Returns a pointer to the mapped file contents on success.
+Returns NULL if the file cannot be mapped (it is not a regular file, like a pipe, or it is empty),
+in which case the file should be read with streaming I/O instead.
+*/
+const unsigned char *map_file(FILE *file, size_t *size) {
+    struct stat fileStat;
+    if (!is_regular_file(file) || fstat(fileno(file), &fileStat) != 0 || fileStat.st_size == 0) {
+        return NULL;
+    }
+
+    void *data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    *size = fileStat.st_size;
+    return data;
+}
+
+/*
+Unmap the <size> bytes of file contents at <data> mapped by map_file().
+*/
+void unmap_file(const unsigned char *data, size_t size) {
+    munmap((void *) data, size);
+}
+
+/*
+Returns a pointer to the canonical Huffman encoding of <freqs> named <name>, with no
+encoding longer than <maxLength> bits if <maxLength> is not 0.
+<maxLength> must be large enough for every symbol of <freqs> to get an encoding.
+*/
+Encoding *generate_encoding(Frequencies *freqs, char name[MAX_NAME], int maxLength) {
+    if (maxLength > 0) {
+        return generateLengthLimitedEncoding(*freqs, name, maxLength);
+    }
+    return generateCanonicalEncoding(*freqs, name);
+}
+
+/*
+A block of input to be encoded by encode_job() on a worker thread.
+<table> is the table the block is encoded with. It is shared read-only between jobs.
+<input> points either into the memory mapped input file or to <readBuffer>.
+<outputLen> is set to the return value of encode_block_streams() once the job has run,
+which splits the block into <numStreams> streams.
+
+When compressing adaptively, table_job() first sets <counts> to the number of times every
+symbol occurs in the block and builds the block's own encoding <blockEncoding> and
+<blockTable> (NULL when not compressing adaptively), with no encoding longer than
+<maxLength> bits if <maxLength> is not 0. <tableSize> is the size of <blockEncoding> in the
+container if the block is encoded with its own table and 0 otherwise.
+*/
+typedef struct encodeJob {
+    EncodeTable *table;
+    const unsigned char *input;
+    unsigned char *readBuffer;
+    size_t inputLen;
+    unsigned char *output;
+    long outputLen;
+    int numStreams;
+    uint64_t counts[ENCODE_TABLE_SIZE];
+    Encoding *blockEncoding;
+    EncodeTable *blockTable;
+    uint32_t tableSize;
+    int maxLength;
+} EncodeJob;
+
+/*
+Helper for encode_file().
+Encode the block of the EncodeJob pointed to by <arg>. Used as a pthread start routine.
+*/
+static void *encode_job(void *arg) {
+    EncodeJob *job = arg;
+    job->outputLen = encode_block_streams(job->table, job->input, job->inputLen,
+                                          job->numStreams, job->output);
+    return NULL;
+}
+
+/*
+Helper for encode_file().
+Count the symbols of the block of the EncodeJob pointed to by <arg> and build the block's
+own encoding and encode table from them. Used as a pthread start routine.
+*/
+static void *table_job(void *arg) {
+    EncodeJob *job = arg;
+    memset(job->counts, 0, sizeof(job->counts));
+    count_symbols(job->input, job->inputLen, job->counts);
+
+    // Block encodings are not named to keep the tables small
+    char name[MAX_NAME] = "";
+    Frequencies *freqs = newFrequenciesFromCounts(job->counts, name);
+    job->blockEncoding = generate_encoding(freqs, name, job->maxLength);
+    job->blockTable = newEncodeTable(job->blockEncoding);
+    destroyFrequencies(freqs);
+    return NULL;
+}
+
+/*
+Helper for encode_file().
+Run <routine> on the first <numJobs> jobs of <jobs>, the first on this thread and the
+others on the threads of <threads>.
+
+Returns 0 on success.
+Returns 3 if a thread could not be started.
+*/
+static int run_encode_jobs(void *(*routine)(void *), EncodeJob *jobs, int numJobs,
+                           pthread_t *threads) {
+    int ret = 0;
+    int numStarted = 0;
+    for (int i = 1; i < numJobs; i++) {
+        if (pthread_create(&threads[i], NULL, routine, &jobs[i]) != 0) {
+            ret = 3;
+            break;
+        }
+        numStarted++;
+    }
+    if (numJobs > 0) {
+        routine(&jobs[0]);
+    }
+    for (int i = 1; i <= numStarted; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return ret;
+}
+
+/*
+Given a plaintext <inputFile> and an <encoding>, encode the input file into a
+compressed container (see container.h) written to <outputFile>.
+
+The encoding is stored in the container as the canonical encodings of the same
+lengths, which are also the encodings used to compress the input. The encodings of
+<encoding> are replaced with those canonical encodings.
+The input is compressed in blocks of CMP_BLOCK_SIZE bytes that can each be decoded on
+their own. Every symbol is encoded with a single lookup in the encode table built
+by newEncodeTable(). Every block is split into <numStreams> (1 or CODEC_STREAMS) interleaved
+streams that are decoded together (see encode_block_streams()).
+
+If <adaptive> is true, the input is compressed in smaller blocks of CMP_ADAPTIVE_BLOCK_SIZE
+bytes and every block is given its own encoding generated from the block's symbol counts,
+stored in the block. The block encodings are limited to <maxLength> bits if <maxLength>
+is not 0. A block keeps the table of the previous block (initially <encoding>,
+which may be empty) if that table encodes every symbol of the block and its own table would
+not make the block, including the table, at least 1/ADAPTIVE_MIN_GAIN smaller.
+
+With <numThreads> greater than 1, batches of <numThreads> blocks are read and encoded
+concurrently (sharing the encode table) and then written out in input order, so the
+output is the same for any number of threads.
+
+Regular input files are memory mapped and encoded in place. Other inputs (like pipes)
+are read into block buffers with fread(). The container is written front to back without
+seeking so <outputFile> may be a pipe.
+
+If <stats> is not NULL, the time spent reading, encoding and writing and the symbols of the
+input are added to it. Its input bytes are the size of the input and its output bytes are the
+size of the container.
+
+Returns 0 on success.
+Returns 1 if a character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile> or starting a thread
+*/
+int encode_file(FILE *inputFile, FILE *outputFile, Encoding *encoding, bool adaptive,
+                int maxLength, int numStreams, int numThreads, CodingStats *stats) {
+    double mark = start_phase(stats);
+
+    // The container only stores the encoding lengths so the canonical encodings are used
+    if (canonicalizeEncoding(encoding) != 0) {
+        return 1;
+    }
+    EncodeTable *table = newEncodeTable(encoding);
+    if (table == NULL) {
+        return 1;
+    }
+    end_phase(stats, CODING_PHASE_CODE, &mark);
+
+    int ret = encode_file_with_table(inputFile, outputFile, encoding, table, adaptive, maxLength,
+                                     numStreams, numThreads, stats);
+    destroyEncodeTable(table);
+    return ret;
+}
+
+/*
+Given a plaintext <inputFile>, a canonical <encoding> and the encode table <table> built from
+it by newEncodeTable(), encode the input file into a compressed container written to
+<outputFile> like encode_file() does. Neither <encoding> nor <table> is modified, so files can
+be encoded with the same encoding and table on any number of threads at once.
+
+Returns 0 on success.
+Returns 1 if a character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile> or starting a thread
+*/
+int encode_file_with_table(FILE *inputFile, FILE *outputFile, Encoding *encoding,
+                           EncodeTable *table, bool adaptive, int maxLength, int numStreams,
+                           int numThreads, CodingStats *stats) {
+    double mark = start_phase(stats);
+
+    uint32_t blockSize = adaptive ? CMP_ADAPTIVE_BLOCK_SIZE : CMP_BLOCK_SIZE;
+    long headerLen = writeContainerHeader(outputFile, blockSize, numStreams, encoding);
+    if (headerLen < 0) {
+        return 2;
+    }
+
+    size_t mappedSize = 0;
+    size_t mappedPos = 0;
+    const unsigned char *mapped = map_file(inputFile, &mappedSize);
+    if (mapped != NULL) {
+        madvise((void *) mapped, mappedSize, MADV_SEQUENTIAL);
+    }
+
+    int numJobs = numThreads > 1 ? numThreads : 1;
+    EncodeJob *jobs = malloc(sizeof(EncodeJob) * numJobs);
+    pthread_t *threads = malloc(sizeof(pthread_t) * numJobs);
+    if (jobs == NULL || threads == NULL) {
+        fprintf(stderr, "Failed to allocate memory for encode jobs\n");
+        exit(1);
+    }
+    for (int i = 0; i < numJobs; i++) {
+        jobs[i].table = table;
+        jobs[i].blockEncoding = NULL;
+        jobs[i].blockTable = NULL;
+        jobs[i].tableSize = 0;
+        jobs[i].maxLength = maxLength;
+        jobs[i].numStreams = numStreams;
+        jobs[i].readBuffer = mapped == NULL ? malloc(blockSize) : NULL;
+        jobs[i].output = malloc(ENCODE_BOUND(blockSize));
+        if ((mapped == NULL && jobs[i].readBuffer == NULL) || jobs[i].output == NULL) {
+            fprintf(stderr, "Failed to allocate memory for block buffers\n");
+            exit(1);
+        }
+    }
+
+    BlockIndex *index = newBlockIndex();
+    // The offset of the next block in the output file and in the input file
+    uint64_t offset = headerLen;
+    uint64_t rawOffset = 0;
+    // The table the next block is encoded with unless it gets its own, and its offset
+    EncodeTable *currentTable = table;
+    uint64_t tableOffset = CMP_ENCODING_OFFSET;
+
+    end_phase(stats, CODING_PHASE_CODE, &mark);
+
+    int ret = 0;
+    bool inputEnded = false;
+    while (ret == 0 && !inputEnded) {
+        // Read in the next batch of blocks
+        int numBlocks = 0;
+        while (numBlocks < numJobs) {
+            EncodeJob *job = &jobs[numBlocks];
+            if (mapped != NULL) {
+                job->input = mapped + mappedPos;
+                job->inputLen = mappedSize - mappedPos < blockSize ? mappedSize - mappedPos
+                                                                   : blockSize;
+                mappedPos += job->inputLen;
+            } else {
+                job->input = job->readBuffer;
+                job->inputLen = fread(job->readBuffer, 1, blockSize, inputFile);
+            }
+            if (job->inputLen == 0) {
+                inputEnded = true;
+                break;
+            }
+            numBlocks++;
+        }
+        end_phase(stats, CODING_PHASE_READ, &mark);
+
+        // Build the tables of the batch and choose the table of every block in input order
+        EncodeTable *batchStartTable = currentTable;
+        if (adaptive) {
+            ret = run_encode_jobs(table_job, jobs, numBlocks, threads);
+        }
+        for (int i = 0; adaptive && ret == 0 && i < numBlocks; i++) {
+            EncodeJob *job = &jobs[i];
+            job->table = currentTable;
+            job->tableSize = 0;
+
+            uint64_t currentBits = encodedBits(currentTable, job->counts);
+            long tableSize = compactEncodingSize(job->blockEncoding);
+            uint64_t blockBits = encodedBits(job->blockTable, job->counts) + tableSize * 8;
+            bool worthNewTable = currentBits > blockBits
+                                 && currentBits - blockBits > currentBits / ADAPTIVE_MIN_GAIN;
+            if (currentBits == UINT64_MAX || worthNewTable) {
+                job->table = job->blockTable;
+                job->tableSize = tableSize;
+                currentTable = job->blockTable;
+            }
+        }
+
+        // Encode the batch
+        if (ret == 0) {
+            ret = run_encode_jobs(encode_job, jobs, numBlocks, threads);
+        }
+        end_phase(stats, CODING_PHASE_CODE, &mark);
+
+        for (int i = 0; stats != NULL && ret == 0 && i < numBlocks; i++) {
+            if (jobs[i].outputLen >= 0) {
+                count_stats_symbols(stats, jobs[i].input, jobs[i].inputLen);
+                stats->inputBytes += jobs[i].inputLen;
+                stats->payloadBytes += jobs[i].outputLen;
+            }
+        }
+        end_phase(stats, CODING_PHASE_STATS, &mark);
+
+        // Write the batch out in order
+        for (int i = 0; ret == 0 && i < numBlocks; i++) {
+            if (jobs[i].outputLen < 0) {
+                ret = 1;
+                break;
+            }
+            if (writeBlockHeader(outputFile, jobs[i].inputLen, jobs[i].outputLen,
+                                 jobs[i].tableSize) != 0
+                || (jobs[i].tableSize > 0
+                    && writeCompactEncoding(outputFile, jobs[i].blockEncoding) != jobs[i].tableSize)
+                || fwrite(jobs[i].output, 1, jobs[i].outputLen, outputFile)
+                   != (size_t) jobs[i].outputLen) {
+                ret = 2;
+                break;
+            }
+            offset += CMP_BLOCK_HEADER_SIZE;
+            if (jobs[i].tableSize > 0) {
+                tableOffset = offset;
+                offset += jobs[i].tableSize;
+            }
+
+            addBlock(index, offset, jobs[i].outputLen, rawOffset, jobs[i].inputLen, tableOffset);
+            offset += jobs[i].outputLen;
+            rawOffset += jobs[i].inputLen;
+        }
+        end_phase(stats, CODING_PHASE_WRITE, &mark);
+
+        // Free the block tables that are no longer used by the next block
+        for (int i = 0; i < numBlocks; i++) {
+            if (jobs[i].blockTable != NULL && jobs[i].blockTable != currentTable) {
+                destroyEncodeTable(jobs[i].blockTable);
+            }
+            if (jobs[i].blockEncoding != NULL) {
+                destroyEncoding(jobs[i].blockEncoding);
+            }
+            jobs[i].blockTable = NULL;
+            jobs[i].blockEncoding = NULL;
+        }
+        if (batchStartTable != currentTable && batchStartTable != table) {
+            destroyEncodeTable(batchStartTable);
+        }
+    }
+
+    if (ret == 0 && ferror(inputFile)) {
+        ret = 3;
+    }
+    if (ret == 0) {
+        ret = writeBlockHeader(outputFile, 0, 0, 0);
+        offset += CMP_BLOCK_HEADER_SIZE;
+    }
+    if (ret == 0) {
+        ret = writeBlockIndex(outputFile, index, offset);
+    }
+    if (stats != NULL) {
+        end_phase(stats, CODING_PHASE_WRITE, &mark);
+        stats->outputBytes += offset + (uint64_t) index->numBlocks * CMP_INDEX_ENTRY_SIZE
+                              + CMP_TRAILER_SIZE;
+    }
+
+    destroyBlockIndex(index);
+    if (currentTable != table) {
+        destroyEncodeTable(currentTable);
+    }
+    if (mapped != NULL) {
+        unmap_file(mapped, mappedSize);
+    }
+    for (int i = 0; i < numJobs; i++) {
+        free(jobs[i].readBuffer);
+        free(jobs[i].output);
+    }
+    free(jobs);
+    free(threads);
+    return ret;
+}
+
+/*
+Given a compressed <inputFile> in the legacy format (the encoded bits followed by a
+FOOTER_SIZE byte footer holding the number of padding bits) and the <encoding>
+it was compressed with, decode the input file.
+
+The compressed bits are decoded with the lookup tables built by newDecodeTable(), one
+read buffer at a time, by a Decoder that carries the undecoded bits over from one read
+buffer to the next (see decode_bits()).
+
+If <stats> is not NULL, the time spent reading, decoding and writing and the decoded symbols
+are added to it. Its input bytes are the size of <inputFile>.
+
+Returns 0 on success.
+Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile>
+*/
+int decode_legacy_file(FILE *inputFile, FILE *outputFile, Encoding *encoding,
+                       CodingStats *stats) {
+    double mark = start_phase(stats);
+    // The footer of the file stores the number of padding bits we used.
+    if (fseek(inputFile, -1 * FOOTER_SIZE, SEEK_END) == -1) {
+        return 3;
+    }
+    // The number of body content bytes before the footer
+    long contentBytesLeft = ftell(inputFile);
+
+    FOOTER_TYPE numPaddingBits = 0;
+    if (fread(&numPaddingBits, FOOTER_SIZE, 1, inputFile) != 1) {
+        return 3;
+    }
+    rewind(inputFile);
+
+    // The number of encoded bits in the body
+    long bitsLeft = contentBytesLeft * 8 - numPaddingBits;
+    if (contentBytesLeft < 1 || numPaddingBits < 0 || numPaddingBits > 8) {
+        return 3;
+    }
+
+    DecodeTable *table = newDecodeTable(encoding);
+    if (table == NULL) {
+        return 1;
+    }
+    Decoder decoder = newDecoder(table, bitsLeft);
+    if (stats != NULL) {
+        stats->inputBytes += contentBytesLeft + FOOTER_SIZE;
+        stats->payloadBytes += contentBytesLeft;
+    }
+
+    unsigned char readBuffer[IO_BUFFER_SIZE];
+    size_t readLen = 0;
+    size_t readPos = 0;
+    unsigned char writeBuffer[IO_BUFFER_SIZE];
+
+    int ret = 0;
+    while (decoder.bitsLeft > 0) {
+        if (readPos == readLen && contentBytesLeft > 0) {
+            size_t toRead = contentBytesLeft < IO_BUFFER_SIZE ? contentBytesLeft : IO_BUFFER_SIZE;
+            readLen = fread(readBuffer, 1, toRead, inputFile);
+            readPos = 0;
+            if (readLen == 0) {
+                ret = 3;
+                break;
+            }
+            contentBytesLeft -= readLen;
+            end_phase(stats, CODING_PHASE_READ, &mark);
+        }
+
+        size_t inputUsed;
+        long writeLen = decode_bits(&decoder, readBuffer + readPos, readLen - readPos, &inputUsed,
+                                    writeBuffer, IO_BUFFER_SIZE);
+        if (writeLen < 0 || (writeLen == 0 && inputUsed == 0 && contentBytesLeft == 0)) {
+            // An encoding is not in the alphabet or the body ended in the middle of one
+            ret = 1;
+            break;
+        }
+        readPos += inputUsed;
+        end_phase(stats, CODING_PHASE_CODE, &mark);
+
+        if (fwrite(writeBuffer, 1, writeLen, outputFile) != (size_t) writeLen) {
+            ret = 2;
+            break;
+        }
+        end_phase(stats, CODING_PHASE_WRITE, &mark);
+        if (stats != NULL) {
+            count_stats_symbols(stats, writeBuffer, writeLen);
+            stats->outputBytes += writeLen;
+            end_phase(stats, CODING_PHASE_STATS, &mark);
+        }
+    }
+
+    destroyDecodeTable(table);
+    return ret;
+}
+
+/*
+Helper for decode_range().
+Read the compact encoding at offset <tableOffset> of the container <file> and store a pointer
+to its decode table in <table>.
+
+Returns 0 on success.
+Returns 1 if the encoding is not a valid prefix-free encoding.
+Returns 3 if the encoding could not be read.
+*/
+static int read_decode_table(FILE *file, uint64_t tableOffset, DecodeTable **table) {
+    Encoding encoding;
+    if (fseek(file, tableOffset, SEEK_SET) != 0 || readCompactEncoding(file, &encoding) != 0) {
+        return 3;
+    }
+    *table = newDecodeTable(&encoding);
+    return *table == NULL ? 1 : 0;
+}
+
+/*
+A block of a container to be decoded by decode_job() on a worker thread.
+<table> is the table the block is decoded with. It is shared read-only between jobs.
+<input> points either into the memory mapped container or to <readBuffer>.
+<ret> is set to the return value of decode_block_streams() once the job has run, which
+decodes the <numStreams> streams of the block.
+*/
+typedef struct decodeJob {
+    DecodeTable *table;
+    BlockInfo *block;
+    int numStreams;
+    const unsigned char *input;
+    unsigned char *readBuffer;
+    unsigned char *output;
+    int ret;
+} DecodeJob;
+
+/*
+Helper for decode_range().
+Decode the block of the DecodeJob pointed to by <arg>. Used as a pthread start routine.
+*/
+static void *decode_job(void *arg) {
+    DecodeJob *job = arg;
+    job->ret = decode_block_streams(job->table, job->input, job->block->size, job->numStreams,
+                                    job->output, job->block->rawSize);
+    return NULL;
+}
+
+/*
+Given a compressed container <inputFile>, decode the <rangeLength> uncompressed bytes starting
+at uncompressed offset <rangeStart> into <outputFile>. The range is cut short at the end
+of the uncompressed data.
+
+The block index is used to find the blocks holding the range so only those blocks
+are read and decoded. The decode table of a block is built from the table the block index
+points it to, once for every run of blocks sharing a table. With <numThreads> greater than 1,
+batches of <numThreads> blocks are decoded concurrently (sharing decode tables) and then
+written out in order.
+
+Regular input files are memory mapped and the blocks are decoded in place. Otherwise
+the blocks are read into block buffers with fread(). Inputs that cannot be seeked, like pipes,
+have no usable block index and are decoded front to back by decode_stream() instead, which
+reads past the blocks before the range.
+
+If <stats> is not NULL, the time spent reading, decoding and writing and the symbols written
+are added to it. Only the share of a block's encoded streams that decodes to the bytes written
+counts towards its payload bytes. Its input bytes are the size of the container when all of
+the data is decoded, and the same as the payload bytes otherwise.
+
+Returns 0 on success.
+Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile>, it is not a valid container
+or a thread could not be started
+*/
+int decode_range(FILE *inputFile, FILE *outputFile, uint64_t rangeStart, uint64_t rangeLength,
+                 int numThreads, CodingStats *stats) {
+    if (!is_regular_file(inputFile)) {
+        return decode_stream(inputFile, outputFile, rangeStart, rangeLength, stats);
+    }
+
+    double mark = start_phase(stats);
+    Encoding encoding;
+    uint32_t blockSize;
+    int numStreams;
+    rewind(inputFile);
+    if (readContainerHeader(inputFile, &blockSize, &numStreams, &encoding) != 0
+        || (numStreams != 1 && numStreams != CODEC_STREAMS)) {
+        return 3;
+    }
+
+    BlockIndex *index = readBlockIndex(inputFile);
+    if (index == NULL) {
+        return 3;
+    }
+    bool wholeFile = rangeStart == 0 && rangeLength == UINT64_MAX;
+    struct stat fileStat;
+    if (stats != NULL && wholeFile && fstat(fileno(inputFile), &fileStat) == 0) {
+        stats->inputBytes += fileStat.st_size;
+    }
+    // The decode table of the last block read and the offset of its table
+    DecodeTable *table = NULL;
+    uint64_t tableOffset = 0;
+
+    size_t mappedSize = 0;
+    const unsigned char *mapped = map_file(inputFile, &mappedSize);
+
+    int numJobs = numThreads > 1 ? numThreads : 1;
+    DecodeJob *jobs = malloc(sizeof(DecodeJob) * numJobs);
+    pthread_t *threads = malloc(sizeof(pthread_t) * numJobs);
+    // The decode tables replaced during a batch, freed once the batch is decoded
+    DecodeTable **oldTables = malloc(sizeof(DecodeTable *) * numJobs);
+    if (jobs == NULL || threads == NULL || oldTables == NULL) {
+        fprintf(stderr, "Failed to allocate memory for decode jobs\n");
+        exit(1);
+    }
+    for (int i = 0; i < numJobs; i++) {
+        jobs[i].readBuffer = mapped == NULL ? malloc(ENCODE_BOUND(blockSize)) : NULL;
+        jobs[i].output = malloc(blockSize);
+        if ((mapped == NULL && jobs[i].readBuffer == NULL) || jobs[i].output == NULL) {
+            fprintf(stderr, "Failed to allocate memory for block buffers\n");
+            exit(1);
+        }
+    }
+
+    uint64_t rangeEnd = rangeStart + rangeLength;
+    if (rangeEnd < rangeStart) {
+        // The range runs to the end of the uncompressed data
+        rangeEnd = UINT64_MAX;
+    }
+
+    int ret = 0;
+    int nextBlock = findBlock(index, rangeStart);
+    while (ret == 0 && nextBlock < index->numBlocks
+           && index->blocks[nextBlock].rawOffset < rangeEnd) {
+        // Read in the next batch of blocks inside the range
+        int numBlocks = 0;
+        int numOldTables = 0;
+        while (numBlocks < numJobs && nextBlock < index->numBlocks
+               && index->blocks[nextBlock].rawOffset < rangeEnd) {
+            BlockInfo *block = &index->blocks[nextBlock];
+            if (block->rawSize > blockSize || block->size > ENCODE_BOUND(blockSize)) {
+                ret = 3;
+                break;
+            }
+            if (table == NULL || block->tableOffset != tableOffset) {
+                if (table != NULL) {
+                    oldTables[numOldTables++] = table;
+                    table = NULL;
+                }
+                ret = read_decode_table(inputFile, block->tableOffset, &table);
+                if (ret != 0) {
+                    break;
+                }
+                tableOffset = block->tableOffset;
+            }
+            if (mapped != NULL) {
+                // The block index was validated to lie within the file
+                jobs[numBlocks].input = mapped + block->offset;
+            } else if (fseek(inputFile, block->offset, SEEK_SET) != 0
+                       || fread(jobs[numBlocks].readBuffer, 1, block->size, inputFile) != block->size) {
+                ret = 3;
+                break;
+            } else {
+                jobs[numBlocks].input = jobs[numBlocks].readBuffer;
+            }
+
+            jobs[numBlocks].table = table;
+            jobs[numBlocks].block = block;
+            jobs[numBlocks].numStreams = numStreams;
+            numBlocks++;
+            nextBlock++;
+        }
+        if (ret != 0) {
+            for (int i = 0; i < numOldTables; i++) {
+                destroyDecodeTable(oldTables[i]);
+            }
+            break;
+        }
+        end_phase(stats, CODING_PHASE_READ, &mark);
+
+        // Decode the batch. The first block is decoded on this thread.
+        int numStarted = 0;
+        for (int i = 1; i < numBlocks; i++) {
+            if (pthread_create(&threads[i], NULL, decode_job, &jobs[i]) != 0) {
+                ret = 3;
+                break;
+            }
+            numStarted++;
+        }
+        decode_job(&jobs[0]);
+        for (int i = 1; i <= numStarted; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        end_phase(stats, CODING_PHASE_CODE, &mark);
+
+        // Write the batch out in order, only writing the part of each block inside the range
+        for (int i = 0; ret == 0 && i < numBlocks; i++) {
+            BlockInfo *block = jobs[i].block;
+            if (jobs[i].ret != 0) {
+                ret = 1;
+                break;
+            }
+
+            uint64_t writeStart = rangeStart > block->rawOffset ? rangeStart - block->rawOffset : 0;
+            uint64_t writeEnd = block->rawSize;
+            if (rangeEnd - block->rawOffset < writeEnd) {
+                writeEnd = rangeEnd - block->rawOffset;
+            }
+            size_t writeLen = writeEnd - writeStart;
+            if (fwrite(&jobs[i].output[writeStart], 1, writeLen, outputFile) != writeLen) {
+                ret = 2;
+                break;
+            }
+            if (stats != NULL) {
+                end_phase(stats, CODING_PHASE_WRITE, &mark);
+                count_stats_symbols(stats, &jobs[i].output[writeStart], writeLen);
+                stats->outputBytes += writeLen;
+                uint64_t payloadBytes = (uint64_t) block->size * writeLen / block->rawSize;
+                stats->payloadBytes += payloadBytes;
+                stats->inputBytes += wholeFile ? 0 : payloadBytes;
+                end_phase(stats, CODING_PHASE_STATS, &mark);
+            }
+        }
+        end_phase(stats, CODING_PHASE_WRITE, &mark);
+
+        for (int i = 0; i < numOldTables; i++) {
+            destroyDecodeTable(oldTables[i]);
+        }
+    }
+
+    if (table != NULL) {
+        destroyDecodeTable(table);
+    }
+    destroyBlockIndex(index);
+    if (mapped != NULL) {
+        unmap_file(mapped, mappedSize);
+    }
+    for (int i = 0; i < numJobs; i++) {
+        free(jobs[i].readBuffer);
+        free(jobs[i].output);
+    }
+    free(jobs);
+    free(threads);
+    free(oldTables);
+    return ret;
+}
+
+/*
+Given a compressed container <inputFile>, decode the <rangeLength> uncompressed bytes starting
+at uncompressed offset <rangeStart> front to back into <outputFile> by following the block
+headers up to the end of stream marker. The input is never seeked so <inputFile> may be a pipe,
+and only one block is held in memory at a time. The decode table is rebuilt whenever a block
+carries its own table. Blocks before the range are read past without being decoded, and
+reading stops at the first block after the range.
+
+If <stats> is not NULL, the time spent reading, decoding and writing and the symbols written
+are added to it. Its input bytes are the bytes read, up to the end of stream marker or the end
+of the range, and the payload bytes are the encoded streams of the blocks decoded.
+
+Returns 0 on success.
+Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile> or it is not a valid container
+*/
+int decode_stream(FILE *inputFile, FILE *outputFile, uint64_t rangeStart, uint64_t rangeLength,
+                  CodingStats *stats) {
+    double mark = start_phase(stats);
+    Encoding encoding;
+    uint32_t blockSize;
+    int numStreams;
+    if (readContainerHeader(inputFile, &blockSize, &numStreams, &encoding) != 0
+        || (numStreams != 1 && numStreams != CODEC_STREAMS)) {
+        return 3;
+    }
+
+    DecodeTable *table = newDecodeTable(&encoding);
+    if (table == NULL) {
+        return 1;
+    }
+    if (stats != NULL) {
+        stats->inputBytes += CMP_ENCODING_OFFSET + compactEncodingSize(&encoding)
+                             + CMP_BLOCK_HEADER_SIZE;
+    }
+
+    unsigned char *readBuffer = malloc(ENCODE_BOUND(blockSize));
+    unsigned char *writeBuffer = malloc(blockSize);
+    if (readBuffer == NULL || writeBuffer == NULL) {
+        fprintf(stderr, "Failed to allocate memory for block buffers\n");
+        exit(1);
+    }
+
+    uint64_t rangeEnd = rangeStart + rangeLength;
+    if (rangeEnd < rangeStart) {
+        // The range runs to the end of the uncompressed data
+        rangeEnd = UINT64_MAX;
+    }
+    // The uncompressed offset of the next block
+    uint64_t rawOffset = 0;
+
+    int ret = 0;
+    while (ret == 0 && rawOffset < rangeEnd) {
+        uint32_t rawSize;
+        uint32_t size;
+        uint32_t tableSize;
+        if (readBlockHeader(inputFile, &rawSize, &size, &tableSize) != 0) {
+            ret = 3;
+            break;
+        }
+        if (rawSize == 0) {
+            // End of stream marker. The block index and trailer after it are not needed.
+            break;
+        }
+        if (tableSize > 0) {
+            Encoding blockEncoding;
+            if (readCompactEncoding(inputFile, &blockEncoding) != 0
+                || compactEncodingSize(&blockEncoding) != tableSize) {
+                ret = 3;
+                break;
+            }
+            destroyDecodeTable(table);
+            table = newDecodeTable(&blockEncoding);
+            if (table == NULL) {
+                ret = 1;
+                break;
+            }
+        }
+        if (rawSize > blockSize || size > ENCODE_BOUND(blockSize)
+            || fread(readBuffer, 1, size, inputFile) != size) {
+            ret = 3;
+            break;
+        }
+        end_phase(stats, CODING_PHASE_READ, &mark);
+        uint64_t blockStart = rawOffset;
+        rawOffset += rawSize;
+        if (stats != NULL) {
+            stats->inputBytes += tableSize + size + CMP_BLOCK_HEADER_SIZE;
+        }
+        if (rawOffset <= rangeStart) {
+            // The block comes before the range
+            continue;
+        }
+
+        if (decode_block_streams(table, readBuffer, size, numStreams, writeBuffer, rawSize) != 0) {
+            ret = 1;
+            break;
+        }
+        end_phase(stats, CODING_PHASE_CODE, &mark);
+        // The part of the block inside the range
+        uint32_t writeStart = rangeStart > blockStart ? rangeStart - blockStart : 0;
+        uint32_t writeEnd = rangeEnd < rawOffset ? rangeEnd - blockStart : rawSize;
+        uint32_t writeLen = writeEnd - writeStart;
+        if (fwrite(writeBuffer + writeStart, 1, writeLen, outputFile) != writeLen) {
+            ret = 2;
+            break;
+        }
+        end_phase(stats, CODING_PHASE_WRITE, &mark);
+
+        if (stats != NULL) {
+            count_stats_symbols(stats, writeBuffer + writeStart, writeLen);
+            stats->outputBytes += writeLen;
+            stats->payloadBytes += size;
+            end_phase(stats, CODING_PHASE_STATS, &mark);
+        }
+    }
+
+    if (table != NULL) {
+        destroyDecodeTable(table);
+    }
+    free(readBuffer);
+    free(writeBuffer);
+    return ret;
+}
+
+/*
+Given a compressed <inputFile>, decode the input file into <outputFile>.
+
+Compressed containers carry their own encoding. Regular files have <numThreads> blocks
+decoded at a time using the block index (see decode_range()). Other inputs, like pipes,
+are decoded front to back without seeking (see decode_stream()).
+Files in the legacy format are decoded on one thread with <encoding>, which must be the
+encoding they were compressed with. They must be regular files as the footer is read first.
+Statistics are added to <stats> if it is not NULL (see the function the file is decoded with).
+
+Returns 0 on success.
+Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile>
+Returns 4 if <inputFile> is in the legacy format and <encoding> is NULL
+*/
+int decode_file(FILE *inputFile, FILE *outputFile, Encoding *encoding, int numThreads,
+                CodingStats *stats) {
+    if (!is_regular_file(inputFile)) {
+        return decode_stream(inputFile, outputFile, 0, UINT64_MAX, stats);
+    }
+
+    char header[CMP_HEADER_SIZE];
+    if (fread(header, 1, CMP_HEADER_SIZE, inputFile) == CMP_HEADER_SIZE
+        && memcmp(header, CMP_HEADER, CMP_HEADER_SIZE) == 0) {
+        return decode_range(inputFile, outputFile, 0, UINT64_MAX, numThreads, stats);
+    }
+    if (ferror(inputFile)) {
+        return 3;
+    }
+
+    if (encoding == NULL) {
+        return 4;
+    }
+    rewind(inputFile);
+    return decode_legacy_file(inputFile, outputFile, encoding, stats);
+}
+
+/*
+Count the symbols of <inputFile> and save the Huffman encoding of their frequencies to
+<encodingFilepath>, named after the last component of <encodingFilepath>.
+No encoding is longer than <maxLength> bits if <maxLength> is not 0.
+Memory mapped input files are counted in <numThreads> chunks concurrently.
+
+Returns 0 on success.
+Returns 2 if there was an error saving the encoding to <encodingFilepath>
+Returns 3 if there was an error reading from <inputFile>
+*/
+int train_encoding(FILE *inputFile, char *encodingFilepath, int maxLength, int numThreads) {
+    uint64_t counts[HISTOGRAM_SIZE];
+    memset(counts, 0, sizeof(counts));
+
+    size_t mappedSize = 0;
+    const unsigned char *mapped = map_file(inputFile, &mappedSize);
+    if (mapped != NULL) {
+        int countRet = count_symbols_threaded(mapped, mappedSize, numThreads, counts);
+        unmap_file(mapped, mappedSize);
+        if (countRet != 0) {
+            return 3;
+        }
+    } else {
+        unsigned char *buffer = malloc(IO_BUFFER_SIZE);
+        if (buffer == NULL) {
+            fprintf(stderr, "Failed to allocate memory for the input buffer\n");
+            exit(1);
+        }
+        size_t readLen;
+        while ((readLen = fread(buffer, 1, IO_BUFFER_SIZE, inputFile)) > 0) {
+            count_symbols(buffer, readLen, counts);
+        }
+        free(buffer);
+        if (ferror(inputFile)) {
+            return 3;
+        }
+    }
+
+    // The encoding is named after the encoding file (without its directories)
+    char name[MAX_NAME];
+    char *basename = strrchr(encodingFilepath, '/');
+    basename = basename == NULL ? encodingFilepath : basename + 1;
+    strncpy(name, basename, MAX_NAME - 1);
+    name[MAX_NAME - 1] = '\0';
+
+    Frequencies *freqs = newFrequenciesFromCounts(counts, name);
+    Encoding *encoding = generate_encoding(freqs, name, maxLength);
+    destroyFrequencies(freqs);
+
+    int ret = save(encodingFilepath, encoding) == 0 ? 0 : 2;
+    destroyEncoding(encoding);
+    return ret;
+}
@@ -0,0 +1,249 @@
+#ifndef COMPRESSOR_H
+#define COMPRESSOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "encoding.h"
+#include "encode_table.h"
+
+/*
+The phases of compressing or decompressing a file that are timed in CodingStats.
+CODING_PHASE_STATS is the time spent collecting the statistics themselves.
+*/
+typedef enum codingPhase {
+    CODING_PHASE_LOAD,
+    CODING_PHASE_READ,
+    CODING_PHASE_CODE,
+    CODING_PHASE_WRITE,
+    CODING_PHASE_STATS,
+    CODING_NUM_PHASES
+} CodingPhase;
+
+/*
+Statistics collected while compressing or decompressing a file.
+<seconds>[phase] is the wall clock time spent in every CodingPhase.
+<inputBytes> and <outputBytes> are the sizes of the input and output (see the functions that
+fill them in). <symbols> is the number of uncompressed symbols, <counts>[c] is the number of them
+that are the byte c, and <payloadBytes> is the size of the encoded streams of their blocks
+(including the padding of every stream and the jump tables, but without the container headers,
+tables and index).
+
+The functions that take a CodingStats pointer only collect statistics if it is not NULL, so
+they cost nothing when statistics are not wanted.
+*/
+typedef struct codingStats {
+    double seconds[CODING_NUM_PHASES];
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+    uint64_t symbols;
+    uint64_t payloadBytes;
+    uint64_t counts[256];
+} CodingStats;
+
+/*
+Initializes and returns new empty statistics
+*/
+CodingStats newCodingStats();
+
+/*
+Returns the current time in seconds from a monotonic clock.
+*/
+double coding_clock();
+
+/*
+Write <stats> of compressing (if <compressing> is true) or decompressing a file to <file>,
+as a single JSON object if <json> is true and as lines of text otherwise.
+*/
+void print_coding_stats(FILE *file, CodingStats *stats, bool compressing, bool json);
+
+/*
+Returns the description of the error <ret> returned by compressing (if <compressing> is true)
+or decompressing a file with encode_file(), decode_file() or the functions they use.
+*/
+const char *coding_error(int ret, bool compressing);
+
+/*
+Returns true if <file> is a regular file (which can be memory mapped and seeked)
+and false otherwise (like for a pipe or terminal).
+*/
+bool is_regular_file(FILE *file);
+
+/*
+Map the whole of <file> into memory read-only and store its size in <size>.
+
+Returns a pointer to the mapped file contents on success.
+Returns NULL if the file cannot be mapped (it is not a regular file, like a pipe, or it is empty),
+in which case the file should be read with streaming I/O instead.
+*/
+const unsigned char *map_file(FILE *file, size_t *size);
+
+/*
+Unmap the <size> bytes of file contents at <data> mapped by map_file().
+*/
+void unmap_file(const unsigned char *data, size_t size);
+
+/*
+Returns a pointer to the canonical Huffman encoding of <freqs> named <name>, with no
+encoding longer than <maxLength> bits if <maxLength> is not 0.
+<maxLength> must be large enough for every symbol of <freqs> to get an encoding.
+*/
+Encoding *generate_encoding(Frequencies *freqs, char name[MAX_NAME], int maxLength);
+
+/*
+Given a plaintext <inputFile> and an <encoding>, encode the input file into a
+compressed container (see container.h) written to <outputFile>.
+
+The encoding is stored in the container as the canonical encodings of the same
+lengths, which are also the encodings used to compress the input. The encodings of
+<encoding> are replaced with those canonical encodings.
+The input is compressed in blocks of CMP_BLOCK_SIZE bytes that can each be decoded on
+their own. Every symbol is encoded with a single lookup in the encode table built
+by newEncodeTable(). Every block is split into <numStreams> (1 or CODEC_STREAMS) interleaved
+streams that are decoded together (see encode_block_streams()).
+
+If <adaptive> is true, the input is compressed in smaller blocks of CMP_ADAPTIVE_BLOCK_SIZE
+bytes and every block is given its own encoding generated from the block's symbol counts,
+stored in the block. The block encodings are limited to <maxLength> bits if <maxLength>
+is not 0. A block keeps the table of the previous block (initially <encoding>,
+which may be empty) if that table encodes every symbol of the block and its own table would
+not make the block, including the table, at least 1/ADAPTIVE_MIN_GAIN smaller.
+
+With <numThreads> greater than 1, batches of <numThreads> blocks are read and encoded
+concurrently (sharing the encode table) and then written out in input order, so the
+output is the same for any number of threads.
+
+Regular input files are memory mapped and encoded in place. Other inputs (like pipes)
+are read into block buffers with fread(). The container is written front to back without
+seeking so <outputFile> may be a pipe.
+
+If <stats> is not NULL, the time spent reading, encoding and writing and the symbols of the
+input are added to it. Its input bytes are the size of the input and its output bytes are the
+size of the container.
+
+Returns 0 on success.
+Returns 1 if a character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile> or starting a thread
+*/
+int encode_file(FILE *inputFile, FILE *outputFile, Encoding *encoding, bool adaptive,
+                int maxLength, int numStreams, int numThreads, CodingStats *stats);
+
+/*
+Given a plaintext <inputFile>, a canonical <encoding> and the encode table <table> built from
+it by newEncodeTable(), encode the input file into a compressed container written to
+<outputFile> like encode_file() does. Neither <encoding> nor <table> is modified, so files can
+be encoded with the same encoding and table on any number of threads at once.
+
+Returns 0 on success.
+Returns 1 if a character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile> or starting a thread
+*/
+int encode_file_with_table(FILE *inputFile, FILE *outputFile, Encoding *encoding,
+                           EncodeTable *table, bool adaptive, int maxLength, int numStreams,
+                           int numThreads, CodingStats *stats);
+
+/*
+Given a compressed <inputFile> in the legacy format (the encoded bits followed by a
+FOOTER_SIZE byte footer holding the number of padding bits) and the <encoding>
+it was compressed with, decode the input file.
+
+The compressed bits are decoded with the lookup tables built by newDecodeTable(), one
+read buffer at a time, by a Decoder that carries the undecoded bits over from one read
+buffer to the next (see decode_bits()).
+
+If <stats> is not NULL, the time spent reading, decoding and writing and the decoded symbols
+are added to it. Its input bytes are the size of <inputFile>.
+
+Returns 0 on success.
+Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile>
+*/
+int decode_legacy_file(FILE *inputFile, FILE *outputFile, Encoding *encoding,
+                       CodingStats *stats);
+
+/*
+Given a compressed container <inputFile>, decode the <rangeLength> uncompressed bytes starting
+at uncompressed offset <rangeStart> into <outputFile>. The range is cut short at the end
+of the uncompressed data.
+
+The block index is used to find the blocks holding the range so only those blocks
+are read and decoded. The decode table of a block is built from the table the block index
+points it to, once for every run of blocks sharing a table. With <numThreads> greater than 1,
+batches of <numThreads> blocks are decoded concurrently (sharing decode tables) and then
+written out in order.
+
+Regular input files are memory mapped and the blocks are decoded in place. Otherwise
+the blocks are read into block buffers with fread(). Inputs that cannot be seeked, like pipes,
+have no usable block index and are decoded front to back by decode_stream() instead, which
+reads past the blocks before the range.
+
+If <stats> is not NULL, the time spent reading, decoding and writing and the symbols written
+are added to it. Only the share of a block's encoded streams that decodes to the bytes written
+counts towards its payload bytes. Its input bytes are the size of the container when all of
+the data is decoded, and the same as the payload bytes otherwise.
+
+Returns 0 on success.
+Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile>, it is not a valid container
+or a thread could not be started
+*/
+int decode_range(FILE *inputFile, FILE *outputFile, uint64_t rangeStart, uint64_t rangeLength,
+                 int numThreads, CodingStats *stats);
+
+/*
+Given a compressed container <inputFile>, decode the <rangeLength> uncompressed bytes starting
+at uncompressed offset <rangeStart> front to back into <outputFile> by following the block
+headers up to the end of stream marker. The input is never seeked so <inputFile> may be a pipe,
+and only one block is held in memory at a time. The decode table is rebuilt whenever a block
+carries its own table. Blocks before the range are read past without being decoded, and
+reading stops at the first block after the range.
+
+If <stats> is not NULL, the time spent reading, decoding and writing and the symbols written
+are added to it. Its input bytes are the bytes read, up to the end of stream marker or the end
+of the range, and the payload bytes are the encoded streams of the blocks decoded.
+
+Returns 0 on success.
+Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile> or it is not a valid container
+*/
+int decode_stream(FILE *inputFile, FILE *outputFile, uint64_t rangeStart, uint64_t rangeLength,
+                  CodingStats *stats);
+
+/*
+Given a compressed <inputFile>, decode the input file into <outputFile>.
+
+Compressed containers carry their own encoding. Regular files have <numThreads> blocks
+decoded at a time using the block index (see decode_range()). Other inputs, like pipes,
+are decoded front to back without seeking (see decode_stream()).
+Files in the legacy format are decoded on one thread with <encoding>, which must be the
+encoding they were compressed with. They must be regular files as the footer is read first.
+Statistics are added to <stats> if it is not NULL (see the function the file is decoded with).
+
+Returns 0 on success.
+Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
+Returns 2 if there was an error writing to the <outputFile>
+Returns 3 if there was an error reading from <inputFile>
+Returns 4 if <inputFile> is in the legacy format and <encoding> is NULL
+*/
+int decode_file(FILE *inputFile, FILE *outputFile, Encoding *encoding, int numThreads,
+                CodingStats *stats);
+
+/*
+Count the symbols of <inputFile> and save the Huffman encoding of their frequencies to
+<encodingFilepath>, named after the last component of <encodingFilepath>.
+No encoding is longer than <maxLength> bits if <maxLength> is not 0.
+Memory mapped input files are counted in <numThreads> chunks concurrently.
+
+Returns 0 on success.
+Returns 2 if there was an error saving the encoding to <encodingFilepath>
+Returns 3 if there was an error reading from <inputFile>
+*/
+int train_encoding(FILE *inputFile, char *encodingFilepath, int maxLength, int numThreads);
+
+#endif
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "container.h"
+
+/*
+Helper to store <value> as <numBytes> little-endian bytes at <bytes>.
+*/
+static void put_le(unsigned char *bytes, uint64_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+        bytes[i] = value >> (8 * i);
+    }
+}
+
+/*
+Helper to return the <numBytes> little-endian bytes at <bytes> as an integer.
+*/
+static uint64_t get_le(const unsigned char *bytes, int numBytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < numBytes; i++) {
+        value |= (uint64_t) bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+/*
+Construct and return a pointer to a new empty block index
+*/
+BlockIndex *newBlockIndex() {
+    BlockIndex *index = malloc(sizeof(BlockIndex));
+    if (index == NULL) {
+        fprintf(stderr, "Failed to allocate memory for new block index struct\n");
+        exit(1);
+    }
+
+    index->numBlocks = 0;
+    index->maxBlocks = 16;
+    index->blocks = malloc(sizeof(BlockInfo) * index->maxBlocks);
+    if (index->blocks == NULL) {
+        fprintf(stderr, "Failed to allocate memory for new block index array\n");
+        exit(1);
+    }
+
+    return index;
+}
+
+/*
+Deconstruct the block index pointed to by <index> and free memory associated with it
+
+Return 0 on success
+Return 1 otherwise
+*/
+int destroyBlockIndex(BlockIndex *index) {
+    free(index->blocks);
+    free(index);
+    return 0;
+}
+
+/*
+Append a block with the given location to the end of <index>.
+*/
+void addBlock(BlockIndex *index, uint64_t offset, uint32_t size, uint64_t rawOffset,
+              uint32_t rawSize, uint64_t tableOffset) {
+    if (index->numBlocks == index->maxBlocks) {
+        index->maxBlocks *= 2;
+        index->blocks = realloc(index->blocks, sizeof(BlockInfo) * index->maxBlocks);
+        if (index->blocks == NULL) {
+            fprintf(stderr, "Failed to allocate memory for block index array\n");
+            exit(1);
+        }
+    }
+
+    BlockInfo *block = &index->blocks[index->numBlocks++];
+    block->offset = offset;
+    block->size = size;
+    block->rawOffset = rawOffset;
+    block->rawSize = rawSize;
+    block->tableOffset = tableOffset;
+}
+
+/*
+Returns the index of the block in <index> that holds the uncompressed byte at <rawOffset>.
+Returns <index>->numBlocks if <rawOffset> is past the end of the uncompressed data.
+*/
+int findBlock(BlockIndex *index, uint64_t rawOffset) {
+    // Binary search for the last block starting at or before rawOffset
+    int low = 0;
+    int high = index->numBlocks;
+    while (high - low > 1) {
+        int mid = low + (high - low) / 2;
+        if (index->blocks[mid].rawOffset <= rawOffset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low < index->numBlocks
+        && rawOffset < index->blocks[low].rawOffset + index->blocks[low].rawSize) {
+        return low;
+    }
+    return index->numBlocks;
+}
+
+/*
+Write the container header with <blockSize>, <numStreams> and the compact form of <encoding>
+to the current position of <file>.
+
+Returns the number of bytes written on success.
+Returns -1 if the header could not be written.
+*/
+long writeContainerHeader(FILE *file, uint32_t blockSize, int numStreams, Encoding *encoding) {
+    unsigned char header[CMP_ENCODING_OFFSET];
+    memcpy(header, CMP_HEADER, CMP_HEADER_SIZE);
+    header[CMP_HEADER_SIZE] = CMP_FORMAT_VERSION;
+    put_le(&header[CMP_HEADER_SIZE + 1], blockSize, 4);
+    header[CMP_HEADER_SIZE + 1 + 4] = numStreams;
+
+    if (fwrite(header, sizeof(header), 1, file) != 1) {
+        return -1;
+    }
+
+    long encodingLen = writeCompactEncoding(file, encoding);
+    if (encodingLen < 0) {
+        return -1;
+    }
+    return sizeof(header) + encodingLen;
+}
+
+/*
+Read the container header from the current position of <file> into <blockSize>, <numStreams>
+and <encoding>.
+
+Returns 0 on success.
+Returns 2 if <file> is not a container of version CMP_FORMAT_VERSION.
+Returns 3 if the header could not be read or the number of streams is 0.
+*/
+int readContainerHeader(FILE *file, uint32_t *blockSize, int *numStreams, Encoding *encoding) {
+    unsigned char header[CMP_ENCODING_OFFSET];
+    if (fread(header, CMP_ENCODING_OFFSET, 1, file) != 1) {
+        return ferror(file) ? 3 : 2;
+    }
+    if (memcmp(header, CMP_HEADER, CMP_HEADER_SIZE) != 0
+        || header[CMP_HEADER_SIZE] != CMP_FORMAT_VERSION) {
+        return 2;
+    }
+    *blockSize = get_le(&header[CMP_HEADER_SIZE + 1], 4);
+    *numStreams = header[CMP_HEADER_SIZE + 1 + 4];
+    if (*numStreams == 0) {
+        return 3;
+    }
+
+    return readCompactEncoding(file, encoding);
+}
+
+/*
+Write the block header of a block with <rawSize> uncompressed bytes, <size> bytes of
+encoded bits and a <tableSize> byte table to the current position of <file>.
+A <rawSize> of 0 writes the end of stream marker.
+
+Returns 0 on success.
+Returns 2 if the block header could not be written.
+*/
+int writeBlockHeader(FILE *file, uint32_t rawSize, uint32_t size, uint32_t tableSize) {
+    unsigned char header[CMP_BLOCK_HEADER_SIZE];
+    put_le(&header[0], rawSize, 4);
+    put_le(&header[4], size, 4);
+    put_le(&header[8], tableSize, 4);
+    if (fwrite(header, CMP_BLOCK_HEADER_SIZE, 1, file) != 1) {
+        return 2;
+    }
+    return 0;
+}
+
+/*
+Read the block header at the current position of <file> into <rawSize>, <size> and <tableSize>.
+A <rawSize> of 0 is the end of stream marker.
+
+Returns 0 on success.
+Returns 3 if the block header could not be read.
+*/
+int readBlockHeader(FILE *file, uint32_t *rawSize, uint32_t *size, uint32_t *tableSize) {
+    unsigned char header[CMP_BLOCK_HEADER_SIZE];
+    if (fread(header, CMP_BLOCK_HEADER_SIZE, 1, file) != 1) {
+        return 3;
+    }
+    *rawSize = get_le(&header[0], 4);
+    *size = get_le(&header[4], 4);
+    *tableSize = get_le(&header[8], 4);
+    return 0;
+}
+
+/*
+Write the block index <index> and the trailer to the current position of <file>.
+<indexOffset> is the offset of the current position from the start of the file.
+
+Returns 0 on success.
+Returns 2 if the block index could not be written.
+*/
+int writeBlockIndex(FILE *file, BlockIndex *index, uint64_t indexOffset) {
+    unsigned char entry[CMP_INDEX_ENTRY_SIZE];
+    for (int i = 0; i < index->numBlocks; i++) {
+        BlockInfo *block = &index->blocks[i];
+        put_le(&entry[0], block->offset, 8);
+        put_le(&entry[8], block->size, 4);
+        put_le(&entry[12], block->rawOffset, 8);
+        put_le(&entry[20], block->rawSize, 4);
+        put_le(&entry[24], block->tableOffset, 8);
+        if (fwrite(entry, CMP_INDEX_ENTRY_SIZE, 1, file) != 1) {
+            return 2;
+        }
+    }
+
+    unsigned char trailer[CMP_TRAILER_SIZE];
+    put_le(&trailer[0], indexOffset, 8);
+    put_le(&trailer[8], index->numBlocks, 4);
+    memcpy(&trailer[12], CMP_TRAILER_MAGIC, 4);
+    if (fwrite(trailer, CMP_TRAILER_SIZE, 1, file) != 1) {
+        return 2;
+    }
+
+    return 0;
+}
+
+/*
+Read the block index from the end of the container <file>.
+The position of <file> is left unspecified.
+
+Returns a pointer to the block index on success.
+Returns NULL if the trailer or block index could not be read or are invalid.
+*/
+BlockIndex *readBlockIndex(FILE *file) {
+    unsigned char trailer[CMP_TRAILER_SIZE];
+    if (fseek(file, -CMP_TRAILER_SIZE, SEEK_END) != 0) {
+        return NULL;
+    }
+    long trailerOffset = ftell(file);
+    if (trailerOffset < 0 || fread(trailer, CMP_TRAILER_SIZE, 1, file) != 1
+        || memcmp(&trailer[12], CMP_TRAILER_MAGIC, 4) != 0) {
+        return NULL;
+    }
+
+    uint64_t indexOffset = get_le(&trailer[0], 8);
+    uint64_t numBlocks = get_le(&trailer[8], 4);
+    if (indexOffset > (uint64_t) trailerOffset
+        || numBlocks * CMP_INDEX_ENTRY_SIZE != trailerOffset - indexOffset
+        || fseek(file, indexOffset, SEEK_SET) != 0) {
+        return NULL;
+    }
+
+    BlockIndex *index = newBlockIndex();
+    uint64_t expectedRawOffset = 0;
+    unsigned char entry[CMP_INDEX_ENTRY_SIZE];
+    for (uint64_t i = 0; i < numBlocks; i++) {
+        if (fread(entry, CMP_INDEX_ENTRY_SIZE, 1, file) != 1) {
+            destroyBlockIndex(index);
+            return NULL;
+        }
+
+        uint64_t offset = get_le(&entry[0], 8);
+        uint32_t size = get_le(&entry[8], 4);
+        uint64_t rawOffset = get_le(&entry[12], 8);
+        uint32_t rawSize = get_le(&entry[20], 4);
+        uint64_t tableOffset = get_le(&entry[24], 8);
+        // Blocks must cover the uncompressed data in order and lie before the index,
+        // and their tables must come before them
+        if (rawOffset != expectedRawOffset || offset > indexOffset || size > indexOffset - offset
+            || tableOffset < CMP_ENCODING_OFFSET || tableOffset >= offset) {
+            destroyBlockIndex(index);
+            return NULL;
+        }
+        expectedRawOffset += rawSize;
+
+        addBlock(index, offset, size, rawOffset, rawSize, tableOffset);
+    }
+
+    return index;
+}
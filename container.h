@@ -0,0 +1,158 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "encoding.h"
+
+/*
+The compressed container format written by encode_file():
+    - CMP_HEADER_SIZE byte header "HFCMP" followed by 1 byte CMP_FORMAT_VERSION
+    - 4 byte maximum number of uncompressed bytes in a block
+    - 1 byte number of interleaved streams every block is encoded as (see encode_block_streams())
+    - the encoding in the compact format of writeCompactEncoding()
+    - the compressed blocks. Every block starts with a CMP_BLOCK_HEADER_SIZE byte block header:
+      the 4 byte number of uncompressed bytes in the block, the 4 byte size of the block's
+      encoded bits and the 4 byte size of the block's table. If the table size is not 0 the
+      block carries its own encoding in the compact format, which the block and the following
+      blocks are encoded with until the next block with a table. Otherwise the block is encoded
+      with the same encoding as the previous block (the container header's encoding for the
+      first block). The encoded streams of up to the maximum block size of input bytes follow,
+      each padded with zeros to a whole byte, and can be decoded on their own.
+    - an end of stream marker: a block header with 0 uncompressed bytes, size 0 and table size 0
+    - the block index: CMP_INDEX_ENTRY_SIZE bytes for every block (see BlockInfo)
+    - CMP_TRAILER_SIZE byte trailer: 8 byte offset of the block index, 4 byte number of
+      blocks and the 4 byte CMP_TRAILER_MAGIC "HFIX"
+All integers are stored little-endian.
+
+The block headers and end of stream marker let the container be decoded front to back
+without seeking (see readBlockHeader()). The block index at the end is used for random access.
+*/
+#define CMP_HEADER "HFCMP"
+#define CMP_HEADER_SIZE 5
+// The version of the container format written by encode_file()
+#define CMP_FORMAT_VERSION 1
+// The number of input bytes compressed into each block
+#define CMP_BLOCK_SIZE (1 << 20)
+// The number of input bytes compressed into each block when every block gets its own table.
+// Smaller blocks follow changes in the input more closely but carry more tables.
+#define CMP_ADAPTIVE_BLOCK_SIZE (1 << 17)
+// The offset of the container header's encoding from the start of the file
+#define CMP_ENCODING_OFFSET (CMP_HEADER_SIZE + 1 + 4 + 1)
+// The size of a block header (4 byte raw size, 4 byte size, 4 byte table size)
+#define CMP_BLOCK_HEADER_SIZE 12
+// The size of a block index entry (8 byte offset, 4 byte size, 8 byte raw offset, 4 byte raw size,
+// 8 byte table offset)
+#define CMP_INDEX_ENTRY_SIZE 32
+#define CMP_TRAILER_MAGIC "HFIX"
+#define CMP_TRAILER_SIZE 16
+
+/*
+The location of a compressed block.
+<offset> is the byte offset of the compressed block's encoded bits (after the block header)
+from the start of the file and <size> is their size in bytes.
+<rawOffset> is the offset of the block's first byte in the uncompressed data
+and <rawSize> is the number of uncompressed bytes in the block.
+<tableOffset> is the byte offset from the start of the file of the compact encoding
+the block is encoded with.
+*/
+typedef struct block_info {
+    uint64_t offset;
+    uint32_t size;
+    uint64_t rawOffset;
+    uint32_t rawSize;
+    uint64_t tableOffset;
+} BlockInfo;
+
+/*
+The index of every block in a container, in order.
+<numBlocks> is the number of blocks and <maxBlocks> is the capacity of <blocks>.
+*/
+typedef struct block_index {
+    BlockInfo *blocks;
+    int numBlocks;
+    int maxBlocks;
+} BlockIndex;
+
+/*
+Construct and return a pointer to a new empty block index
+*/
+BlockIndex *newBlockIndex();
+
+/*
+Deconstruct the block index pointed to by <index> and free memory associated with it
+
+Return 0 on success
+Return 1 otherwise
+*/
+int destroyBlockIndex(BlockIndex *index);
+
+/*
+Append a block with the given location to the end of <index>.
+*/
+void addBlock(BlockIndex *index, uint64_t offset, uint32_t size, uint64_t rawOffset,
+              uint32_t rawSize, uint64_t tableOffset);
+
+/*
+Returns the index of the block in <index> that holds the uncompressed byte at <rawOffset>.
+Returns <index>->numBlocks if <rawOffset> is past the end of the uncompressed data.
+*/
+int findBlock(BlockIndex *index, uint64_t rawOffset);
+
+/*
+Write the container header with <blockSize>, <numStreams> and the compact form of <encoding>
+to the current position of <file>.
+
+Returns the number of bytes written on success.
+Returns -1 if the header could not be written.
+*/
+long writeContainerHeader(FILE *file, uint32_t blockSize, int numStreams, Encoding *encoding);
+
+/*
+Read the container header from the current position of <file> into <blockSize>, <numStreams>
+and <encoding>.
+
+Returns 0 on success.
+Returns 2 if <file> is not a container of version CMP_FORMAT_VERSION.
+Returns 3 if the header could not be read or the number of streams is 0.
+*/
+int readContainerHeader(FILE *file, uint32_t *blockSize, int *numStreams, Encoding *encoding);
+
+/*
+Write the block header of a block with <rawSize> uncompressed bytes, <size> bytes of
+encoded bits and a <tableSize> byte table to the current position of <file>.
+A <rawSize> of 0 writes the end of stream marker.
+
+Returns 0 on success.
+Returns 2 if the block header could not be written.
+*/
+int writeBlockHeader(FILE *file, uint32_t rawSize, uint32_t size, uint32_t tableSize);
+
+/*
+Read the block header at the current position of <file> into <rawSize>, <size> and <tableSize>.
+A <rawSize> of 0 is the end of stream marker.
+
+Returns 0 on success.
+Returns 3 if the block header could not be read.
+*/
+int readBlockHeader(FILE *file, uint32_t *rawSize, uint32_t *size, uint32_t *tableSize);
+
+/*
+Write the block index <index> and the trailer to the current position of <file>.
+<indexOffset> is the offset of the current position from the start of the file.
+
+Returns 0 on success.
+Returns 2 if the block index could not be written.
+*/
+int writeBlockIndex(FILE *file, BlockIndex *index, uint64_t indexOffset);
+
+/*
+Read the block index from the end of the container <file>.
+The position of <file> is left unspecified.
+
+Returns a pointer to the block index on success.
+Returns NULL if the trailer or block index could not be read or are invalid.
+*/
+BlockIndex *readBlockIndex(FILE *file);
+
+#endif
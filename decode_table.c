@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decode_table.h"
+
+/*
+Helper for newDecodeTable().
+Fills every entry of the table starting at <table> that is indexed by <numIndexBits> bits
+and whose lowest <codeBits> bits are <code> with <entry>.
+
+Returns 0 on success.
+Returns 1 if one of the entries was already filled (the encoding is not prefix-free).
+*/
+static int fill_entries(DecodeEntry *table, int numIndexBits, uint32_t code, int codeBits,
+                        DecodeEntry entry) {
+    for (uint32_t high = 0; high < (1u << (numIndexBits - codeBits)); high++) {
+        DecodeEntry *slot = &table[code | (high << codeBits)];
+        if (slot->numSymbols != 0 || slot->numBits != 0) {
+            return 1;
+        }
+        *slot = entry;
+    }
+    return 0;
+}
+
+/*
+Construct and return a pointer to the decode table for <encoding>.
+
+Returns NULL if <encoding> is not a valid prefix-free encoding (an encoding is
+empty, longer than MAX_ENC_SIZE_BITS bits, or a prefix of another encoding).
+Encodings whose lengths break the Kraft inequality are rejected before any table is allocated.
+*/
+DecodeTable *newDecodeTable(const Encoding *encoding) {
+    int lengths[MAX_ALPHABET_LEN];
+    uint32_t codes[MAX_ALPHABET_LEN];
+    // The number of index bits of the secondary table for each primary table entry
+    // (0 if the primary table entry does not link to a secondary table)
+    int subtableBits[DECODE_TABLE_SIZE];
+    memset(subtableBits, 0, sizeof(subtableBits));
+
+    // The Kraft sum of the lengths in units of 2^-MAX_ENC_SIZE_BITS, which is at most
+    // 2^MAX_ENC_SIZE_BITS for every prefix-free encoding
+    uint64_t kraftSum = 0;
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        lengths[i] = encoding->lengths[i];
+        if (lengths[i] == 0 || lengths[i] > MAX_ENC_SIZE_BITS) {
+            return NULL;
+        }
+        codes[i] = encoding->codes[i];
+        kraftSum += 1ULL << (MAX_ENC_SIZE_BITS - lengths[i]);
+
+        if (lengths[i] > DECODE_TABLE_BITS) {
+            int prefix = codes[i] & (DECODE_TABLE_SIZE - 1);
+            if (lengths[i] - DECODE_TABLE_BITS > subtableBits[prefix]) {
+                subtableBits[prefix] = lengths[i] - DECODE_TABLE_BITS;
+            }
+        }
+    }
+
+    if (kraftSum > 1ULL << MAX_ENC_SIZE_BITS) {
+        return NULL;
+    }
+
+    // Lay the secondary tables out after the primary table. Every secondary table holds at
+    // least one encoding of at most MAX_ENC_SIZE_BITS bits, so a valid encoding never needs
+    // more than DECODE_MAX_ENTRIES entries.
+    uint32_t subtableStart[DECODE_TABLE_SIZE];
+    size_t numEntries = DECODE_TABLE_SIZE;
+    for (int prefix = 0; prefix < DECODE_TABLE_SIZE; prefix++) {
+        subtableStart[prefix] = numEntries;
+        if (subtableBits[prefix] > 0) {
+            numEntries += (size_t) 1 << subtableBits[prefix];
+        }
+    }
+    if (numEntries > DECODE_MAX_ENTRIES(encoding->alphabetlen)) {
+        return NULL;
+    }
+
+    DecodeTable *table = malloc(sizeof(DecodeTable));
+    if (table == NULL) {
+        fprintf(stderr, "Failed to allocate memory for new decode table struct\n");
+        exit(1);
+    }
+    table->numEntries = numEntries;
+    // calloc leaves every entry as "no encoding starts with these bits"
+    table->entries = calloc(numEntries, sizeof(DecodeEntry));
+    if (table->entries == NULL) {
+        fprintf(stderr, "Failed to allocate memory for new decode table entries\n");
+        exit(1);
+    }
+
+    // Link the primary entries to their secondary tables
+    for (int prefix = 0; prefix < DECODE_TABLE_SIZE; prefix++) {
+        if (subtableBits[prefix] > 0) {
+            table->entries[prefix].value = subtableStart[prefix];
+            table->entries[prefix].numBits = subtableBits[prefix];
+        }
+    }
+
+    // Fill in the single symbol entries. Short encodings go directly into the primary table,
+    // long encodings go into the secondary table of their first DECODE_TABLE_BITS bits.
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        DecodeEntry entry;
+        entry.value = encoding->alphabet[i];
+        entry.numSymbols = 1;
+        entry.numBits = lengths[i];
+        entry.firstBits = lengths[i];
+
+        int ret;
+        if (lengths[i] <= DECODE_TABLE_BITS) {
+            ret = fill_entries(table->entries, DECODE_TABLE_BITS, codes[i], lengths[i], entry);
+        } else {
+            int prefix = codes[i] & (DECODE_TABLE_SIZE - 1);
+            ret = fill_entries(&table->entries[subtableStart[prefix]], subtableBits[prefix],
+                               codes[i] >> DECODE_TABLE_BITS, lengths[i] - DECODE_TABLE_BITS, entry);
+        }
+
+        if (ret != 0) {
+            destroyDecodeTable(table);
+            return NULL;
+        }
+    }
+
+    // Combine primary entries with the following symbol whenever the encoding of the following
+    // symbol also fits entirely within the DECODE_TABLE_BITS index bits.
+    // The single symbol entries are copied first so that combining reads unmodified entries.
+    DecodeEntry *single = malloc(sizeof(DecodeEntry) * DECODE_TABLE_SIZE);
+    if (single == NULL) {
+        fprintf(stderr, "Failed to allocate memory for decode table construction\n");
+        exit(1);
+    }
+    memcpy(single, table->entries, sizeof(DecodeEntry) * DECODE_TABLE_SIZE);
+
+    for (int index = 0; index < DECODE_TABLE_SIZE; index++) {
+        DecodeEntry first = single[index];
+        if (first.numSymbols != 1) {
+            continue;
+        }
+
+        // The remaining index bits after the first symbol (higher bits are unknown and taken as 0)
+        DecodeEntry second = single[index >> first.numBits];
+        if (second.numSymbols == 1 && first.numBits + second.numBits <= DECODE_TABLE_BITS) {
+            table->entries[index].value = first.value | (second.value << 8);
+            table->entries[index].numSymbols = 2;
+            table->entries[index].numBits = first.numBits + second.numBits;
+        }
+    }
+    free(single);
+
+    return table;
+}
+
+/*
+Deconstruct the decode table pointed to by <table> and free memory associated with it
+
+Return 0 on success
+Return 1 otherwise
+*/
+int destroyDecodeTable(DecodeTable *table) {
+    free(table->entries);
+    free(table);
+    return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef DECODE_TABLE_H
+#define DECODE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "encoding.h"
+
+// The number of stream bits used to index the primary decode table.
+// Encodings of at most DECODE_TABLE_BITS bits are decoded with a single lookup.
+#define DECODE_TABLE_BITS 11
+// The number of entries in the primary decode table
+#define DECODE_TABLE_SIZE (1 << DECODE_TABLE_BITS)
+// The maximum number of symbols a single decode table entry can emit
+#define DECODE_MAX_SYMBOLS 2
+// The maximum number of entries of the decode table of a valid encoding of <alphabetLen>
+// symbols: the primary table and, for as many primary entries as there are symbols, a secondary
+// table for an encoding of MAX_ENC_SIZE_BITS bits
+#define DECODE_MAX_ENTRIES(alphabetLen)                                                        \
+    (DECODE_TABLE_SIZE                                                                         \
+     + ((size_t) ((alphabetLen) < DECODE_TABLE_SIZE ? (alphabetLen) : DECODE_TABLE_SIZE)     \
+        << (MAX_ENC_SIZE_BITS - DECODE_TABLE_BITS)))
+
+/*
+An entry of a decode table, looked up with the next unread bits of the stream
+(the next bit of the stream being the lowest bit of the index).
+
+If <numSymbols> is nonzero, the entry decodes <numSymbols> symbols stored in
+<value> (the first symbol in the lowest byte, the second in the next byte).
+Decoding all of them consumes <numBits> bits of the stream. Decoding only the
+first symbol consumes <firstBits> bits.
+
+If <numSymbols> is 0 and <numBits> is nonzero, the entry links to a secondary
+table starting at index <value> of the decode table entries. The secondary table
+is indexed by the <numBits> stream bits following the first DECODE_TABLE_BITS bits.
+
+If <numSymbols> and <numBits> are both 0, no encoding starts with these bits.
+*/
+typedef struct decode_entry {
+    uint32_t value;
+    uint8_t numSymbols;
+    uint8_t numBits;
+    uint8_t firstBits;
+} DecodeEntry;
+
+/*
+The lookup tables used to decode a bitstream encoded with some Encoding.
+<entries> holds the primary table in its first DECODE_TABLE_SIZE entries
+followed by every secondary table for encodings longer than DECODE_TABLE_BITS bits.
+<numEntries> is the total number of entries, at most DECODE_MAX_ENTRIES of the alphabet length.
+*/
+typedef struct decode_table {
+    DecodeEntry *entries;
+    size_t numEntries;
+} DecodeTable;
+
+/*
+Construct and return a pointer to the decode table for <encoding>.
+
+Returns NULL if <encoding> is not a valid prefix-free encoding (an encoding is
+empty, longer than MAX_ENC_SIZE_BITS bits, or a prefix of another encoding).
+Encodings whose lengths break the Kraft inequality are rejected before any table is allocated.
+*/
+DecodeTable *newDecodeTable(const Encoding *encoding);
+
+/*
+Deconstruct the decode table pointed to by <table> and free memory associated with it
+
+Return 0 on success
+Return 1 otherwise
+*/
+int destroyDecodeTable(DecodeTable *table);
+
+#endif
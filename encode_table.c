@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "encode_table.h"
+
+/*
+Construct and return a pointer to the encode table for <encoding>.
+
+Returns NULL if <encoding> is not valid (an encoding is empty or a symbol
+appears more than once in the alphabet).
+*/
+EncodeTable *newEncodeTable(const Encoding *encoding) {
+    EncodeTable *table = calloc(1, sizeof(EncodeTable));
+    if (table == NULL) {
+        fprintf(stderr, "Failed to allocate memory for new encode table struct\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        EncodeEntry *entry = &table->entries[encoding->alphabet[i]];
+        int length = encoding->lengths[i];
+        if (length == 0 || entry->length != 0) {
+            destroyEncodeTable(table);
+            return NULL;
+        }
+
+        entry->code = encoding->codes[i];
+        entry->length = length;
+    }
+
+    return table;
+}
+
+/*
+Returns the number of bits <table> encodes a block into, where <counts>[s] is the number
+of times the symbol with byte value s occurs in the block.
+Returns UINT64_MAX if a symbol that occurs in the block is not in the encoding alphabet.
+*/
+uint64_t encodedBits(EncodeTable *table, uint64_t counts[ENCODE_TABLE_SIZE]) {
+    uint64_t bits = 0;
+    for (int symbol = 0; symbol < ENCODE_TABLE_SIZE; symbol++) {
+        if (counts[symbol] == 0) {
+            continue;
+        }
+        if (table->entries[symbol].length == 0) {
+            return UINT64_MAX;
+        }
+        bits += counts[symbol] * table->entries[symbol].length;
+    }
+    return bits;
+}
+
+/*
+Deconstruct the encode table pointed to by <table> and free memory associated with it
+
+Return 0 on success
+Return 1 otherwise
+*/
+int destroyEncodeTable(EncodeTable *table) {
+    free(table);
+    return 0;
+}
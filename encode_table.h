@@ -0,0 +1,52 @@
+#ifndef ENCODE_TABLE_H
+#define ENCODE_TABLE_H
+
+#include <stdint.h>
+#include "encoding.h"
+
+// The number of entries in an encode table (one for every possible byte value)
+#define ENCODE_TABLE_SIZE 256
+
+/*
+An entry of an encode table.
+<code> holds the <length> bits of a symbol's encoding in stream order
+(the first bit of the encoding is the lowest bit of <code>).
+<length> is 0 if the symbol is not in the encoding alphabet.
+*/
+typedef struct encode_entry {
+    uint32_t code;
+    uint32_t length;
+} EncodeEntry;
+
+/*
+The compiled form of an Encoding used to encode a symbol with a single lookup.
+<entries> is indexed by the byte value of the symbol.
+*/
+typedef struct encode_table {
+    EncodeEntry entries[ENCODE_TABLE_SIZE];
+} EncodeTable;
+
+/*
+Construct and return a pointer to the encode table for <encoding>.
+
+Returns NULL if <encoding> is not valid (an encoding is empty or a symbol
+appears more than once in the alphabet).
+*/
+EncodeTable *newEncodeTable(const Encoding *encoding);
+
+/*
+Returns the number of bits <table> encodes a block into, where <counts>[s] is the number
+of times the symbol with byte value s occurs in the block.
+Returns UINT64_MAX if a symbol that occurs in the block is not in the encoding alphabet.
+*/
+uint64_t encodedBits(EncodeTable *table, uint64_t counts[ENCODE_TABLE_SIZE]);
+
+/*
+Deconstruct the encode table pointed to by <table> and free memory associated with it
+
+Return 0 on success
+Return 1 otherwise
+*/
+int destroyEncodeTable(EncodeTable *table);
+
+#endif
@@ -4,25 +4,184 @@
 #include <getopt.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include "encoding.h"
+#include "codec.h"
+#include "compressor.h"
+#include "batch.h"
 
 // Data structure used for the input argument data
 typedef struct inputArgData {
     // true if we are compressing the input file. false if we are decompressing.
     bool compressing;
+    // true if we are training an encoding from the input file (written to <encodingFilepath>).
+    bool training;
+    // true if every block is compressed with its own encoding generated from the block.
+    bool adaptive;
     FILE *inputFile;
     FILE *outputFile;
-    // The filepath containing the encoding representation.
+    // The filepath of <outputFile> (NULL if it is standard output).
+    char *outputFilepath;
+    // The filepath containing the encoding representation (NULL if none was given).
     char *encodingFilepath;
+    // The range of uncompressed data to decompress (the whole file by default).
+    uint64_t rangeStart;
+    uint64_t rangeLength;
+    // The number of threads used to compress or decompress the input file.
+    int numThreads;
+    // The maximum length in bits of generated encodings (0 if they are not limited).
+    int maxLength;
+    // The number of interleaved streams every compressed block is split into.
+    int numStreams;
+    // true if statistics are reported to standard error, as JSON if <statsJson> is true.
+    bool stats;
+    bool statsJson;
+    // true if the <numBatchFiles> files at <batchInputPaths> are coded into the files at
+    // <batchOutputPaths> instead of the input file into the output file.
+    bool batch;
+    char **batchInputPaths;
+    char **batchOutputPaths;
+    int numBatchFiles;
 } InputArgData;
 
+/*
+Returns the default output filepath of <inputFilepath>: the input file appended with ".cmp"
+for compressing or with ".txt" for decompressing. If <outputDir> is not NULL the output file
+is put in the directory <outputDir> instead of the directory of the input file.
+*/
+char *output_filepath(char *outputDir, char *inputFilepath, bool compressing) {
+    // Will be changed in the future to replace ".cmp" if it exists when decompressing
+    char *extension = compressing ? ".cmp" : ".txt";
+    char *basename = inputFilepath;
+    if (outputDir != NULL) {
+        basename = strrchr(inputFilepath, '/');
+        basename = basename == NULL ? inputFilepath : basename + 1;
+    }
+
+    // +6 accounts for the "/", the extension and the null terminating byte
+    size_t len = (outputDir != NULL ? strlen(outputDir) : 0) + strlen(basename) + 6;
+    char *outputFilepath = malloc(len);
+    if (outputFilepath == NULL) {
+        fprintf(stderr, "Failed to allocate memory for output filepath\n");
+        exit(1);
+    }
+    if (outputDir != NULL) {
+        snprintf(outputFilepath, len, "%s/%s%s", outputDir, basename, extension);
+    } else {
+        snprintf(outputFilepath, len, "%s%s", basename, extension);
+    }
+    return outputFilepath;
+}
+
+/*
+Helper for read_batch_list() to order filepaths with qsort().
+*/
+int compare_filepaths(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/*
+Read the files of a batch from <listPath>: every regular file in it (in name order) if it
+is a directory, and otherwise the filepaths it holds, one per line ("-" reads them from
+standard input). Empty lines are skipped.
+Stores the number of files in <numFiles> and returns an array of their filepaths.
+Exits if <listPath> cannot be read.
+*/
+char **read_batch_list(char *listPath, int *numFiles) {
+    int capacity = 64;
+    char **paths = malloc(sizeof(char *) * capacity);
+    if (paths == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the batch file list\n");
+        exit(1);
+    }
+    *numFiles = 0;
+
+    struct stat listStat;
+    bool isDir = strcmp(listPath, "-") != 0 && stat(listPath, &listStat) == 0
+                 && S_ISDIR(listStat.st_mode);
+    DIR *dir = NULL;
+    FILE *listFile = NULL;
+    if (isDir) {
+        dir = opendir(listPath);
+    } else {
+        listFile = strcmp(listPath, "-") == 0 ? stdin : fopen(listPath, "r");
+    }
+    if (dir == NULL && listFile == NULL) {
+        fprintf(stderr, "Failed to open the batch file list %s\n", listPath);
+        exit(1);
+    }
+
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    for (;;) {
+        char *path = NULL;
+        if (isDir) {
+            struct dirent *entry = readdir(dir);
+            if (entry == NULL) {
+                break;
+            }
+            size_t len = strlen(listPath) + strlen(entry->d_name) + 2;
+            path = malloc(len);
+            if (path == NULL) {
+                fprintf(stderr, "Failed to allocate memory for the batch file list\n");
+                exit(1);
+            }
+            snprintf(path, len, "%s/%s", listPath, entry->d_name);
+            struct stat fileStat;
+            if (stat(path, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+                free(path);
+                continue;
+            }
+        } else {
+            ssize_t len = getline(&line, &lineCapacity, listFile);
+            if (len < 0) {
+                break;
+            }
+            while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+                line[--len] = '\0';
+            }
+            if (len == 0) {
+                continue;
+            }
+            path = strdup(line);
+            if (path == NULL) {
+                fprintf(stderr, "Failed to allocate memory for the batch file list\n");
+                exit(1);
+            }
+        }
+
+        if (*numFiles == capacity) {
+            capacity *= 2;
+            paths = realloc(paths, sizeof(char *) * capacity);
+            if (paths == NULL) {
+                fprintf(stderr, "Failed to allocate memory for the batch file list\n");
+                exit(1);
+            }
+        }
+        paths[(*numFiles)++] = path;
+    }
+
+    free(line);
+    if (isDir) {
+        closedir(dir);
+        qsort(paths, *numFiles, sizeof(char *), compare_filepaths);
+    } else if (listFile != stdin) {
+        fclose(listFile);
+    }
+    return paths;
+}
+
 /*
 Parse the program input arguments and verify input validity.
 Returns a struct representing the input argument data.
 */
 InputArgData parse_input_args(int argc, char **argv) {
     // The string used in error messages related to invalid input arguments.
-    char *INPUT_ERR_STR = "Usage: %s -i <input_file> -e <encoding_file> (-c|-d) [-o <output_file>]\n";
+    char *INPUT_ERR_STR = "Usage: %s (-i <input_file>|-b <file_list>) [-e <encoding_file>] (-c|-d|-g) [-a]"
+                          " [-o <output_file>] [-s <offset>] [-n <length>] [-j <threads>]"
+                          " [-l <max_bits>] [-m] [--stats[=json]]\n";
 
     // If called with no arguments, print usage string.
     if (argc == 1) {
@@ -33,14 +192,30 @@ InputArgData parse_input_args(int argc, char **argv) {
     // Load the options
     char opt;  // stores the input character
     char *inputFilepath = "";
+    char *batchListPath = "";
     char *encodingFilepath = "";
     int compressing = -1; // > 0 if we are compressing the file, = 0 if we are decompressing the file
+    bool training = false;
+    bool adaptive = false;
     // Optional arguments
     char *outputFilepath = "";
+    uint64_t rangeStart = 0;
+    uint64_t rangeLength = UINT64_MAX;
+    int numThreads = 0;
+    int maxLength = 0;
+    int numStreams = 1;
+    bool stats = false;
+    bool statsJson = false;
+    // The long options, which getopt_long() returns as their short option character
+    // (--stats has no short option)
+    struct option longOptions[] = {
+        {"stats", optional_argument, NULL, 'S'},
+        {NULL, 0, NULL, 0}
+    };
 
     // sets a flag to stop getopt from printing an error message on invalid option.
     opterr = 0;
-    while ((opt = getopt(argc, argv, "i:o:e:cd")) != -1) {
+    while ((opt = getopt_long(argc, argv, "i:o:e:cdgas:n:j:l:mb:", longOptions, NULL)) != -1) {
         switch (opt) {
             case 'i':
                 inputFilepath = strdup(optarg);
@@ -48,6 +223,12 @@ InputArgData parse_input_args(int argc, char **argv) {
                     exit(2);
                 }
                 break;
+            case 'b':
+                batchListPath = strdup(optarg);
+                if (batchListPath == NULL) {
+                    exit(2);
+                }
+                break;
             case 'e':
                 encodingFilepath = strdup(optarg);
                 if (encodingFilepath == NULL) {
@@ -66,6 +247,47 @@ InputArgData parse_input_args(int argc, char **argv) {
             case 'd':
                 compressing = 0;
                 break;
+            case 'g':
+                training = true;
+                compressing = 0;
+                break;
+            case 'a':
+                adaptive = true;
+                break;
+            case 's':
+                rangeStart = strtoull(optarg, NULL, 10);
+                break;
+            case 'n':
+                rangeLength = strtoull(optarg, NULL, 10);
+                break;
+            case 'j':
+                numThreads = atoi(optarg);
+                if (numThreads < 1) {
+                    fprintf(stderr, "The number of threads must be at least 1\n");
+                    exit(1);
+                }
+                break;
+            case 'l':
+                maxLength = atoi(optarg);
+                // Every byte value must still fit in the encodings
+                if (maxLength < 8 || maxLength > MAX_ENC_SIZE_BITS) {
+                    fprintf(stderr, "The maximum encoding length must be between 8 and %d bits\n",
+                            MAX_ENC_SIZE_BITS);
+                    exit(1);
+                }
+                break;
+            case 'm':
+                numStreams = CODEC_STREAMS;
+                break;
+            case 'S':
+                stats = true;
+                if (optarg != NULL && strcmp(optarg, "json") == 0) {
+                    statsJson = true;
+                } else if (optarg != NULL) {
+                    fprintf(stderr, "The statistics format must be json or left out for text\n");
+                    exit(1);
+                }
+                break;
             default:
                 fprintf(stderr, INPUT_ERR_STR, argv[0]);
                 exit(1);
@@ -75,69 +297,109 @@ InputArgData parse_input_args(int argc, char **argv) {
     // Test that all required variables were set and given.
     // The user must specify if they are compressing or decompressing the file
     if (compressing == -1) {
-        fprintf(stderr, "Required: specify compressing with -c or decompressing with -d\n");
+        fprintf(stderr, "Required: specify compressing with -c, decompressing with -d"
+                        " or training an encoding with -g\n");
         exit(1);
     }
 
     // The string variables are all initialized as empty strings.
-    if (inputFilepath[0] == '\0' || encodingFilepath[0] == '\0') {
+    // Compressed containers carry their own encoding so it is only required for compressing
+    // without -a and training (where it is the file the trained encoding is written to).
+    bool batch = batchListPath[0] != '\0';
+    if ((inputFilepath[0] == '\0') == !batch
+        || (((compressing && !adaptive) || training) && encodingFilepath[0] == '\0')) {
         fprintf(stderr, INPUT_ERR_STR, argv[0]);
         exit(1);
     }
+    // Batches compress or decompress whole files
+    if (batch && (training || rangeStart != 0 || rangeLength != UINT64_MAX)) {
+        fprintf(stderr, "A batch (-b) can only be compressed or decompressed as whole files\n");
+        exit(1);
+    }
+    // Batches code a file per thread on every processor by default
+    if (numThreads == 0) {
+        long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = batch && numProcessors > 1 ? numProcessors : 1;
+    }
 
     // If the output filepath was not provided, generate it from the input filepath.
     // The default is the input file appended with ".cmp" for compressing
-    // or the input file appended with ".txt" for decompressing
-    if (outputFilepath[0] == '\0') {
-        if (compressing) {
-            int inputFileLen = strlen(inputFilepath);
-            // +5 accounts for the ".cmp" and the null terminating byte
-            outputFilepath = malloc(inputFileLen + 5);
-            if (outputFilepath == NULL) {
-                exit(1);
-            }
-
-            // The inputfilepath is null terminated so we add + 1 to copy that null terminator over to the 
-            // output filepath. This sets up the call to strncat which expects a null terminated dest str.
-            strncpy(outputFilepath, inputFilepath, inputFileLen + 1);
-            strncat(outputFilepath, ".cmp", 5);
-        } else {
-            // Will be changed in the future to replace ".cmp" if it exists
-            int inputFileLen = strlen(inputFilepath);
-            // +5 accounts for the ".txt" and the null terminating byte
-            outputFilepath = malloc(inputFileLen + 5);
-            if (outputFilepath == NULL) {
-                exit(1);
-            }
+    // or the input file appended with ".txt" for decompressing.
+    // Standard input is written to standard output by default.
+    if (outputFilepath[0] == '\0' && strcmp(inputFilepath, "-") == 0) {
+        outputFilepath = "-";
+    }
+    if (outputFilepath[0] == '\0' && !training && !batch) {
+        outputFilepath = output_filepath(NULL, inputFilepath, compressing);
+    }
 
-            // The inputfilepath is null terminated so we add + 1 to copy that null terminator over to the 
-            // output filepath. This sets up the call to strncat which expects a null terminated dest str.
-            strncpy(outputFilepath, inputFilepath, inputFileLen + 1);
-            strncat(outputFilepath, ".txt", 5);
+    // The output file of every file of a batch is named like the output file of a single
+    // input file, in the directory given with -o if there is one
+    InputArgData inputArgs;
+    inputArgs.batch = batch;
+    inputArgs.batchInputPaths = NULL;
+    inputArgs.batchOutputPaths = NULL;
+    inputArgs.numBatchFiles = 0;
+    if (batch) {
+        struct stat outputStat;
+        if (outputFilepath[0] != '\0'
+            && (stat(outputFilepath, &outputStat) != 0 || !S_ISDIR(outputStat.st_mode))) {
+            fprintf(stderr, "Invalid output directory (-o must be a directory with -b)\n");
+            exit(1);
         }
 
+        inputArgs.batchInputPaths = read_batch_list(batchListPath, &inputArgs.numBatchFiles);
+        inputArgs.batchOutputPaths = malloc(sizeof(char *) * (inputArgs.numBatchFiles + 1));
+        if (inputArgs.batchOutputPaths == NULL) {
+            fprintf(stderr, "Failed to allocate memory for the batch file list\n");
+            exit(1);
+        }
+        for (int i = 0; i < inputArgs.numBatchFiles; i++) {
+            inputArgs.batchOutputPaths[i] = output_filepath(
+                outputFilepath[0] != '\0' ? outputFilepath : NULL,
+                inputArgs.batchInputPaths[i], compressing);
+        }
     }
 
-    // Check that files exist
-    if (access(inputFilepath, F_OK) != 0) {
+    // Check that files exist ("-" is standard input)
+    if (!batch && strcmp(inputFilepath, "-") != 0 && access(inputFilepath, F_OK) != 0) {
         fprintf(stderr, "Invalid input file (does not exist)\n");
         exit(1);
     }
-    if (access(encodingFilepath, F_OK) != 0) {
+    if (!training && encodingFilepath[0] != '\0' && access(encodingFilepath, F_OK) != 0) {
         fprintf(stderr, "Invalid encoding file (does not exist)\n");
         exit(1);
     }
 
-    InputArgData inputArgs;
-
     inputArgs.compressing = compressing;
-    inputArgs.inputFile = fopen(inputFilepath, "r");
-    inputArgs.outputFile = fopen(outputFilepath, "w");
-    inputArgs.encodingFilepath = strdup(encodingFilepath);
-
-    if (inputArgs.encodingFilepath == NULL) {
-        fprintf(stderr, "Failed to allocate memory for encoding filepath\n");
-        exit(1);
+    inputArgs.training = training;
+    inputArgs.adaptive = adaptive;
+    // The files of a batch are opened as they are coded
+    inputArgs.inputFile = batch || strcmp(inputFilepath, "-") == 0 ? stdin
+                                                                    : fopen(inputFilepath, "r");
+    // Training writes no output file
+    inputArgs.outputFilepath = NULL;
+    if (training || batch || strcmp(outputFilepath, "-") == 0) {
+        inputArgs.outputFile = stdout;
+    } else {
+        inputArgs.outputFile = fopen(outputFilepath, "w");
+        inputArgs.outputFilepath = outputFilepath;
+    }
+    inputArgs.encodingFilepath = NULL;
+    inputArgs.rangeStart = rangeStart;
+    inputArgs.rangeLength = rangeLength;
+    inputArgs.numThreads = numThreads;
+    inputArgs.maxLength = maxLength;
+    inputArgs.numStreams = numStreams;
+    inputArgs.stats = stats;
+    inputArgs.statsJson = statsJson;
+
+    if (encodingFilepath[0] != '\0') {
+        inputArgs.encodingFilepath = strdup(encodingFilepath);
+        if (inputArgs.encodingFilepath == NULL) {
+            fprintf(stderr, "Failed to allocate memory for encoding filepath\n");
+            exit(1);
+        }
     }
 
     if (inputArgs.inputFile == NULL || inputArgs.outputFile == NULL) {
@@ -148,358 +410,150 @@ InputArgData parse_input_args(int argc, char **argv) {
     return inputArgs;
 }
 
-/*
-Returns the ith bit of the <buffer>
-*/
-int get_ith_bit(unsigned char buffer[MAX_ENC_SIZE_BITS * 2], int i) {
-    return (buffer[i / 8] >> i % 8) & 1;
-}
-
-/*
-Set the ith bit of the <buffer> to <bit>
-*/
-void set_ith_bit(unsigned char buffer[MAX_ENC_SIZE_BITS * 2], int i, int bit) {
-    if (bit) {
-        // Bit exists, ensure bit is set to 1
-        buffer[i / 8] = buffer[i / 8] | (1 << i % 8);
-    } else {
-        // Bit is zero, ensure bit is set to 0
-        buffer[i / 8] = buffer[i / 8] & (255 - (1 << i % 8));
-    }
-}
+/* This program reads a text file and compresses or decompresses the file as specified
 
-/*
-Insert the integer <integer> into the bit buffer starting at bit <i>.
+Options:
+    "-i" : Specifies the input file, or "-" for standard input (-i or -b is REQUIRED)
+    "-b" : Compresses or decompresses a batch of files instead of a single input file: every
+           regular file in the given directory, or the files listed one per line in the given
+           file ("-" for standard input). The encoding is loaded once for all of them and the
+           files are coded concurrently. Files that fail are reported and the rest are still
+           coded, and the totals and throughput of the batch are reported to standard error
+           (-i or -b is REQUIRED)
+    "-o" : Specifies the output file, or "-" for standard output (by default outputs the
+           encoded file in the same directory as the original file as filename.cmp, or to
+           standard output when the input is standard input). With -b, specifies the
+           directory the output files are put in (by default the directory of every file).
+           A file whose output file would be the output file of an earlier file fails
+    "-e" : Specifies the compression encoding to use for this file (REQUIRED for -c without -a
+           and for decompressing files in the legacy format)
+    "-c" : Specifies that the input file should be compressed   (-c, -d or -g is REQUIRED)
+    "-d" : Specifies that the input file should be decompressed (-c, -d or -g is REQUIRED)
+    "-g" : Specifies that an encoding should be trained from the symbol frequencies of the
+           input file and saved to the encoding file given with -e (-c, -d or -g is REQUIRED)
+    "-a" : Compress adaptively: every block gets its own encoding generated from the block
+           (the -e encoding, if given, is used for blocks where that does not pay off)
+    "-s" : Decompress starting at this offset of the uncompressed data (default 0). Blocks
+           before it are skipped with the block index, or read past when the input is a pipe
+    "-n" : Decompress at most this many bytes (default: to the end of the data)
+    "-j" : Compress or decompress this many blocks of the input file concurrently, or count
+           this many chunks of the input file concurrently when training (default 1).
+           With -b, compress or decompress this many files concurrently (default: the number
+           of processors)
+    "-l" : Limit the encodings generated with -g or -a to at most this many bits (8 to 32).
+           Short encodings keep the decode tables small (by default encodings are not limited)
+    "-m" : Compress every block as 4 interleaved streams that are decoded together, which
+           decompresses faster at the cost of a few bytes per block
+    "--stats" : Report the time spent in every phase, the sizes, the compression ratio and the
+           entropy and average code length in bits per symbol to standard error when compressing
+           or decompressing. "--stats=json" reports them as a single JSON object.
+           With -b, "--stats=json" reports the totals of the batch as a JSON object.
 */
-void insert_int_by_bit(unsigned int integer, char buffer[MAX_ENC_SIZE_BITS * 2], int i) {
-    // j is the relative index of the bit starting at i
-    for (int j = 0; j < sizeof(int) * 8; j++) {
-        // The absolute index of the bit
-        int bit_index = j + i;
-        // The bit to insert
-        int bit = (integer >> j) & 1;
-
-        buffer[bit_index] = bit;
-    }
-}
+int main(int argc, char **argv) {
+    InputArgData inputData = parse_input_args(argc, argv);
 
-/*
-Returns the number of bits in the encoding array.
-This is the number of entries before we reach ENC_END.
-*/
-int num_bits(int enc[MAX_ENC_SIZE_BITS]) {
-    int num_bits = 0;
-    for (int i = 0; i < MAX_ENC_SIZE_BITS; i++) {
-        if (enc[i] == ENC_END) {
-            return num_bits;
-        }
-        num_bits++;
+    if (inputData.training) {
+        return train_encoding(inputData.inputFile, inputData.encodingFilepath,
+                              inputData.maxLength, inputData.numThreads);
     }
-    return num_bits;
-}
-
-/*
-Given a plaintext <inputFile> and an <encoding>, encode the input file.
-
-The characters are encoded in 8 bit buffers
 
-Returns 0 on success.
-Returns 1 if a character that is not in the encoding alphabet is encountered.
-Returns 2 if there was an error writing to the <outputFile>
-*/
-int encode_file(FILE *inputFile, FILE *outputFile, Encoding encoding) {
-    // We use buffer to store up to 1 byte at a time until we can write a byte to the file.
-    int buffer[8];
-    // The index of the buffer to write the next bit to
-    int bufferi = 0;
-
-    char nextChar = '\0';
-    while ((nextChar = fgetc(inputFile)) != EOF) {
-        for (int i = 0; i <= encoding.alphabetlen; i++) {
-            if (i == encoding.alphabetlen) {
-                // Did not find the character in the alphabet
+    if (inputData.batch) {
+        // The encoding is loaded once for the whole batch
+        Encoding encoding;
+        Encoding *encodingPtr = NULL;
+        if (inputData.encodingFilepath != NULL) {
+            int loadRet = load(inputData.encodingFilepath, &encoding);
+            if (loadRet != 0) {
+                fprintf(stderr, "Failed to load encoding file (error %d)\n", loadRet);
                 return 1;
             }
-
-            if (encoding.alphabet[i] == nextChar) {
-                int charEnc[MAX_ENC_SIZE_BITS];
-                for (int j = 0; j < MAX_ENC_SIZE_BITS; j++) {
-                    charEnc[j] = encoding.encodings[i][j];
-                }
-
-                // The index of the bit in charEnc to write to the buffer
-                // starting at the lowest bit until we've written the whole encoding.
-                // If the encoding is more than a byte in length, the buffer will be written
-                // out to the file.
-                int numBits = num_bits(charEnc);
-                int biti = 0;
-                do {
-                    buffer[bufferi] = charEnc[biti];
-                    biti++;
-                    bufferi++;
-
-                    // Write the bits out if we've filled the buffer
-                    if (bufferi == 8) {
-                        bufferi = 0;
-                        
-                        // Construct a 8-bit sequence in a char type
-                        unsigned char bufferChar = 0;
-
-                        for (int j = 0; j < 8; j++) {
-                            // We bitshift the buffer by the appropriate bits
-                            bufferChar += buffer[j] << j;
-                        }
-
-                        // Write out the corresponding encoding.
-                        if (fwrite(&bufferChar, 1, 1, outputFile) != 1) {
-                            // Failed to write the character
-                            return 2;
-                        }
-                    }
-                } while (biti < numBits);
-
-                // We've found and written the character so break out of the for loop.
-                break;
-            }
+            encodingPtr = &encoding;
         }
-    }
-
-    // Write the remaining bits out with 0 as padding and write out the footer
-    char numPaddingBits = 0;
-    char bufferChar = 0;
-    for (int i = bufferi; i < 8; i++) {
-        buffer[i] = 0;
-        numPaddingBits++;
-    }
-    for (int j = 0; j < 8; j++) {
-        bufferChar += buffer[j] << j;
-    }
-
-    // Write out the corresponding padded encoding for the last character
-    if (fwrite(&bufferChar, 1, 1, outputFile) != 1) {
-        // Failed to write the character
-        return 2;
-    }
-
-    // Write out the footer with the number of padding bits used
-    if (fwrite(&numPaddingBits, FOOTER_SIZE, 1, outputFile) != 1) {
-        // Failed to write footer
-        return 2;
-    }
-
-    return 0;
-}
-
-/*
-Helper for decode_buffer().
-Compares the <charEncArr> and the <intEncArr> to see if they contain the same encoding.
-Two encodings are considered the same if they have the n elements in common followed by a single
-ENC_END element (this means elements after the first ENC_END encountered are not checked).
-
-Returns 0 if the buffers do not contain the same encoding.
-Returns 1 if the buffers contain the same encoding.
-*/
-int sameEncoding(int intEncArr[MAX_ENC_SIZE_BITS], char charEncArr[MAX_ENC_SIZE_BITS]) {
-    for (int i = 0; i < MAX_ENC_SIZE_BITS; i++) {
-        if (intEncArr[i] != charEncArr[i]) {
-            return 0;
+        // Adaptive compression without an encoding starts from an empty encoding
+        Encoding *empty = encodingPtr == NULL && inputData.compressing ? newEncoding("") : NULL;
+
+        BatchStats batchStats;
+        int ret = code_batch(inputData.batchInputPaths, inputData.batchOutputPaths,
+                             inputData.numBatchFiles, inputData.compressing,
+                             encodingPtr != NULL ? encodingPtr : empty, inputData.adaptive,
+                             inputData.maxLength, inputData.numStreams, inputData.numThreads,
+                             &batchStats);
+        if (empty != NULL) {
+            destroyEncoding(empty);
         }
+        for (int i = 0; i < inputData.numBatchFiles; i++) {
+            free(inputData.batchInputPaths[i]);
+            free(inputData.batchOutputPaths[i]);
+        }
+        free(inputData.batchInputPaths);
+        free(inputData.batchOutputPaths);
 
-        if (charEncArr[i] == ENC_END) {
-            return 1;
+        if (ret == 1 && batchStats.numFailed == 0) {
+            fprintf(stderr, "Invalid encoding\n");
+            return ret;
         }
+        print_batch_stats(stderr, &batchStats, inputData.compressing, inputData.statsJson);
+        return ret;
     }
 
-    return 1;
-}
+    // Statistics are only collected with --stats
+    CodingStats stats = newCodingStats();
+    CodingStats *statsPtr = inputData.stats ? &stats : NULL;
+    double mark = inputData.stats ? coding_clock() : 0;
 
-/*
-Helper for decode_file().
-Decode the bits in the 2*MAX_ENC_SIZE_BITS sized <buffer>.
-Stores the index of the start of the current encoding we are examining in 
-<currEncodingIndex>.
-Writes recognized characters to <outputFile>.
-Uses Encoding <encoding>.
-
-Returns 0 on success.
-Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
-Returns 2 if the output file cannot be written to.
-*/
-int decode_buffer(char buffer[MAX_ENC_SIZE_BITS * 2], int *currEncodingIndex, int bufferEnd,
-                   FILE *outputFile, Encoding encoding) {
-    // encArr holds the buffered encoding bits as we match encArr with encodings in <encoding>
-    char encArr[MAX_ENC_SIZE_BITS];
-    for (int i = 0; i < MAX_ENC_SIZE_BITS; i++) {
-        encArr[i] = ENC_END;
-    }
-
-    for (int bufferi = 0; bufferi < bufferEnd; bufferi++) {
-        int encArri = bufferi - *currEncodingIndex;
-        if (encArri == MAX_ENC_SIZE_BITS) {
-            // Maximum encoding size reached, this encoding is not valid
+    Encoding encoding;
+    Encoding *encodingPtr = NULL;
+    if (inputData.encodingFilepath != NULL) {
+        int loadRet = load(inputData.encodingFilepath, &encoding);
+        if (loadRet != 0) {
+            fprintf(stderr, "Failed to load encoding file (error %d)\n", loadRet);
             return 1;
         }
-
-        // Add the ith bit in buffer into the buffered encoding <enc>
-        encArr[encArri] = buffer[bufferi];
-
-        // Search for the encoding in the alphabet
-        for (int encodingsi = 0; encodingsi < encoding.alphabetlen; encodingsi++) {
-            if (encArr[encArri] == ENC_END) {
-                break;
-            }
-
-            if (sameEncoding(encoding.encodings[encodingsi], encArr)) {
-                // Found character, write out to file
-                if (fwrite(&encoding.alphabet[encodingsi], 1, 1, outputFile) != 1) {
-                    return 2;
-                }
-
-                // reset the buffered encoding back to its empty state
-                for (int j = 0; j < MAX_ENC_SIZE_BITS; j++) {
-                    encArr[j] = ENC_END;
-                }
-                // set the new start of the next encoding
-                *currEncodingIndex = bufferi + 1;
-
-                break;
-            }
-        }
+        encodingPtr = &encoding;
     }
-
-    return 0;
-}
-
-/*
-Given a compressed <inputFile> and an <encoding>, decode the input file.
-
-Returns 0 on success.
-Returns 1 if an encoded character that is not in the encoding alphabet is encountered.
-Returns 2 if there was an error writing to the <outputFile>
-Returns 3 if there was an error reading from <inputFile>
-*/
-int decode_file(FILE *inputFile, FILE *outputFile, Encoding encoding) {
-    // The footer of the file stores the number of padding bits we used.
-    if (fseek(inputFile, -1 * FOOTER_SIZE, SEEK_END) == -1) {
-        return 3;
+    if (inputData.stats) {
+        stats.seconds[CODING_PHASE_LOAD] = coding_clock() - mark;
     }
-    // Stores the byte position of beginning of the last body content byte
-    long lastContentByte = ftell(inputFile) - 1;
-
-    FOOTER_TYPE numPaddingBits = 0;
-    if (fread(&numPaddingBits, FOOTER_SIZE, 1, inputFile) == -1) {
-        return 3;
-    }
-    rewind(inputFile);
-
-    // We keep a bit buffer for the input.
-    // (an individual character can be encoded in at most MAX_ENC_SIZE_BYTES bytes
-    // and so we keep 2 * MAX_ENC_SIZE_BITS bits for overflow purposes)
-    char buffer[MAX_ENC_SIZE_BITS * 2];
-
-    // Initialize the buffer using the ENC_END character
-    for (int i = 0; i < MAX_ENC_SIZE_BITS * 2; i++) {
-        buffer[i] = ENC_END;
-    }
-
-    // Read in MAX_ENC_SIZE_BYTES bytes into the buffer starting at the next available bit
-    unsigned int readbuffer = 0;
-    // The index after the last bit of data in the buffer.
-    int bufferEnd = 0;
-    // Keeps track of how many bytes were read for the last call
-    int bytesRead = 0;
-    // Loop until we reach the last content byte or some read issue occurs.
-    for (int currByte = 0; currByte < lastContentByte; currByte++) {
-        // Read in the next byte
-        if ((bytesRead = fread(&readbuffer, 1, 1, inputFile)) != 1) {
-            // Some read error occurred or unexpected EOF
-            return 3;
-        }
-
-        // Insert the readbuffer into the correct bits in the bit buffer <buffer>
-        insert_int_by_bit(readbuffer, buffer, bufferEnd);
-        bufferEnd += bytesRead * 8;
-
-        // Greedily decode the buffered bits
-        // holds the index of the start of the current encoding for shifting the buffer over
-        int currEncodingIndex = 0;
-        
-        // Decode all character encodings present in the buffer
-        int decode_ret = decode_buffer(buffer, &currEncodingIndex, bufferEnd, outputFile, encoding);
-        if (decode_ret != 0) {
-            return decode_ret;
-        }
-
-        // Shift all leftover bits to the beginning of the buffer.
-        // Pad any extra space with ENC_END.
-        int leftover_bit_count = 0;
-        // ri tracks the index of the leftover bits to copy over to the left
-        int ri = currEncodingIndex;
-        // li tracks the index to copy the leftover bits to (from the left)
-        for (int li = 0; li < (MAX_ENC_SIZE_BITS * 2); li++) {
-            // If there are no more leftover bits, we set the lith bit to ENC_END;
-            char leftover_bit = ENC_END;
-            if (ri < bufferEnd) {
-                // There are still leftover bits to read
-                leftover_bit = buffer[ri];
-                leftover_bit_count++;
-            }
 
-            buffer[li] = leftover_bit;
-            ri++;
+    int ret;
+    if (inputData.compressing) {
+        // Adaptive compression without an encoding starts from an empty encoding
+        Encoding *empty = encodingPtr == NULL ? newEncoding("") : NULL;
+        ret = encode_file(inputData.inputFile, inputData.outputFile,
+                          encodingPtr != NULL ? encodingPtr : empty, inputData.adaptive,
+                          inputData.maxLength, inputData.numStreams, inputData.numThreads,
+                          statsPtr);
+        if (empty != NULL) {
+            destroyEncoding(empty);
         }
-        bufferEnd = leftover_bit_count;
-    }
-
-    // Check if we exited the loop because there was a file read error or the file ended unexpectedly
-    // (otherwise we exited because we reached the last content byte position.
-    if (ferror(inputFile) || feof(inputFile)) {
-        return 3;
+    } else if (inputData.rangeStart != 0 || inputData.rangeLength != UINT64_MAX) {
+        ret = decode_range(inputData.inputFile, inputData.outputFile, inputData.rangeStart,
+                           inputData.rangeLength, inputData.numThreads, statsPtr);
+    } else {
+        ret = decode_file(inputData.inputFile, inputData.outputFile, encodingPtr,
+                          inputData.numThreads, statsPtr);
     }
 
-    // We are just before the last content byte. Read this content byte in and turn any padding
-    // bits into ENC_END before decoding the final content byte.
-    if ((bytesRead = fread(&readbuffer, 1, 1, inputFile)) != 1) {
-        return 3;
+    if (inputData.stats) {
+        // Writing out what is left in the output buffer is part of the write time
+        mark = coding_clock();
+        fflush(inputData.outputFile);
+        stats.seconds[CODING_PHASE_WRITE] += coding_clock() - mark;
+        if (ret == 0) {
+            print_coding_stats(stderr, &stats, inputData.compressing, inputData.statsJson);
+        }
     }
 
-    insert_int_by_bit(readbuffer, buffer, bufferEnd);
-    bufferEnd += (bytesRead * 8);
-
-    // Turn the last numPaddingBits into ENC_END as they were padding.
-    for (int i = bufferEnd - 1; i > bufferEnd - numPaddingBits - 1; i--) {
-        buffer[i] = ENC_END;
+    // A failed file is reported and its partial output removed
+    if (ret != 0) {
+        fprintf(stderr, "Failed to %s: %s (error %d)\n",
+                inputData.compressing ? "compress" : "decompress",
+                coding_error(ret, inputData.compressing), ret);
+        if (inputData.outputFilepath != NULL) {
+            fclose(inputData.outputFile);
+            remove(inputData.outputFilepath);
+        }
     }
-    bufferEnd -= numPaddingBits;
 
-    // Decode the last byte as normal
-    int currEncodingIndex = 0;
-    int decode_ret = decode_buffer(buffer, &currEncodingIndex, bufferEnd, outputFile, encoding);
-    return decode_ret;
+    return ret;
 }
-
-/* This program reads a text file and compresses or decompresses the file as specified
-
-Options:
-    "-i" : Specifies the input file (REQUIRED)
-    "-o" : Specifies the output file (by default outputs the encoded file in the
-           same directory as the original file as filename.enc)
-    "-e" : Specifies the compression encoding to use for this file (REQUIRED)
-    "-c" : Specifies that the input file should be compressed   (-c or -d is REQUIRED)
-    "-d" : Specifies that the input file should be decompressed (-c or -d is REQUIRED)
-*/
-int main(int argc, char **argv) {
-    InputArgData inputData = parse_input_args(argc, argv);
-
-    Encoding encoding;
-
-    load(inputData.encodingFilepath, &encoding);
-
-    if (inputData.compressing) {
-        return encode_file(inputData.inputFile, inputData.outputFile, encoding);
-    } else {
-        return decode_file(inputData.inputFile, inputData.outputFile, encoding);
-    }
-
-    return 0;
-}
\ No newline at end of file
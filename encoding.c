@@ -8,8 +8,8 @@
 Construct and return a pointer to a new empty encoding struct with name <name>
 */
 Encoding *newEncoding(char *name) {
-    Encoding *newEnc = malloc(sizeof(Encoding));
-    if (newEnc == NULL) {
+    Encoding *newEnc;
+    if (posix_memalign((void **) &newEnc, ENC_CACHE_LINE, sizeof(Encoding)) != 0) {
         fprintf(stderr, "Failed to allocate memory for new encoding struct\n");
         exit(1);
     }
@@ -21,7 +21,8 @@ Encoding *newEncoding(char *name) {
 
     for (int i = 0; i < MAX_ALPHABET_LEN; i++) {
         newEnc->alphabet[i] = '\0';
-        memset(newEnc->encodings[i], ENC_END, MAX_ENC_SIZE_BITS * sizeof(newEnc->encodings[0]));
+        newEnc->codes[i] = 0;
+        newEnc->lengths[i] = 0;
     }
 
     return newEnc;
@@ -44,7 +45,7 @@ Frequencies *newFrequencies(char *name) {
 
     for (int i = 0; i < MAX_ALPHABET_LEN; i++) {
         newFreq->alphabet[i] = '\0';
-        newFreq->frequencies[i] = 0.0;
+        newFreq->frequencies[i] = 0;
     }
 
     return newFreq;
@@ -74,6 +75,218 @@ int destroyFrequencies(Frequencies *freqPtr) {
     return 0;
 }
 
+/*
+Returns the number of bits in the legacy encoding array <enc> (one int per bit, as stored in
+version 1 encoding files).
+This is the number of entries before we reach ENC_END.
+*/
+int encodingLength(int enc[MAX_ENC_SIZE_BITS]) {
+    int length = 0;
+    while (length < MAX_ENC_SIZE_BITS && enc[length] != ENC_END) {
+        length++;
+    }
+    return length;
+}
+
+/*
+Returns the first <length> bits of the legacy encoding array <enc> packed into an integer
+in stream order (the first bit of the encoding is the lowest bit of the integer).
+*/
+uint32_t packEncoding(int enc[MAX_ENC_SIZE_BITS], int length) {
+    uint32_t packed = 0;
+    for (int i = 0; i < length; i++) {
+        packed |= (uint32_t) (enc[i] & 1) << i;
+    }
+    return packed;
+}
+
+/*
+Replace the encodings in <encoding> with the canonical prefix-free encodings
+where the symbol encoding->alphabet[i] has an encoding of <lengths>[i] bits.
+
+Canonical encodings are assigned in order of increasing length, with symbols of the
+same length ordered by their byte value. Each encoding is the previous encoding
+plus one, extended with trailing zeros to the new length. The order of the alphabet
+is not changed.
+
+Returns 0 on success.
+Returns 1 if the lengths cannot form a prefix-free encoding (a length is not between
+1 and MAX_ENC_SIZE_BITS or there are too many short lengths) or a symbol appears more
+than once in the alphabet.
+*/
+int assignCanonicalEncodings(Encoding *encoding, int lengths[MAX_ALPHABET_LEN]) {
+    // The number of symbols with an encoding of each length
+    int lengthCounts[MAX_ENC_SIZE_BITS + 1];
+    memset(lengthCounts, 0, sizeof(lengthCounts));
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        if (lengths[i] < 1 || lengths[i] > MAX_ENC_SIZE_BITS) {
+            return 1;
+        }
+        lengthCounts[lengths[i]]++;
+    }
+
+    // The first encoding of each length (as an integer with the first bit as the highest bit)
+    uint64_t nextCode[MAX_ENC_SIZE_BITS + 1];
+    uint64_t code = 0;
+    for (int length = 1; length <= MAX_ENC_SIZE_BITS; length++) {
+        code = (code + lengthCounts[length - 1]) << 1;
+        nextCode[length] = code;
+        // The encodings of this length must not run past the all ones encoding
+        if (code + lengthCounts[length] > (1ULL << length)) {
+            return 1;
+        }
+    }
+
+    // The position of every symbol in the alphabet (-1 if it is not in the alphabet)
+    int symbolIndex[256];
+    memset(symbolIndex, -1, sizeof(symbolIndex));
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        if (symbolIndex[encoding->alphabet[i]] != -1) {
+            return 1;
+        }
+        symbolIndex[encoding->alphabet[i]] = i;
+    }
+
+    // Hand out the encodings in order of byte value within each length
+    for (int symbol = 0; symbol < 256; symbol++) {
+        int i = symbolIndex[symbol];
+        if (i == -1) {
+            continue;
+        }
+
+        // The first bit of the encoding is the highest bit of symbolCode but the lowest
+        // bit of the packed code, so the bits are reversed
+        uint64_t symbolCode = nextCode[lengths[i]]++;
+        uint32_t packed = 0;
+        for (int j = 0; j < lengths[i]; j++) {
+            packed |= (uint32_t) ((symbolCode >> (lengths[i] - 1 - j)) & 1) << j;
+        }
+        encoding->codes[i] = packed;
+        encoding->lengths[i] = lengths[i];
+    }
+
+    return 0;
+}
+
+/*
+Replace the encodings in <encoding> with the canonical encodings of the same lengths
+(see assignCanonicalEncodings()).
+
+Returns 0 on success.
+Returns 1 if the encoding lengths cannot form a prefix-free encoding.
+*/
+int canonicalizeEncoding(Encoding *encoding) {
+    int lengths[MAX_ALPHABET_LEN];
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        lengths[i] = encoding->lengths[i];
+    }
+    return assignCanonicalEncodings(encoding, lengths);
+}
+
+// The maximum number of characters in the alphabet of a version 1 encoding file
+#define LEGACY_ALPHABET_LEN 128
+
+/*
+The layout of the Encoding struct data stored in version 1 encoding files,
+from before alphabets held all 256 byte values.
+*/
+typedef struct legacy_encoding {
+    char name[MAX_NAME];
+    int alphabetlen;
+    char alphabet[LEGACY_ALPHABET_LEN];
+    int encodings[LEGACY_ALPHABET_LEN][MAX_ENC_SIZE_BITS];
+} LegacyEncoding;
+
+/*
+Helper for load().
+Load the version 1 (legacy) encoding file body from <file> into <encoding>. The body is
+the raw LegacyEncoding struct data directly after the header. The encoding arrays are
+converted to packed codes as they are.
+
+Returns 0 on success.
+Returns 3 if the encoding could not be loaded.
+*/
+static int load_legacy(FILE *file, Encoding *encoding) {
+    LegacyEncoding newenc;
+    if (fseek(file, HEADER_SIZE, SEEK_SET) != 0
+        || fread(&newenc, sizeof(LegacyEncoding), 1, file) != 1) {
+        return 3;
+    }
+    if (newenc.alphabetlen < 0 || newenc.alphabetlen > LEGACY_ALPHABET_LEN) {
+        return 3;
+    }
+
+    // Success, copy the data over
+    strncpy(encoding->name, newenc.name, MAX_NAME);
+    encoding->name[MAX_NAME - 1] = '\0';
+    encoding->alphabetlen = newenc.alphabetlen;
+    for (int i = 0; i < MAX_ALPHABET_LEN; i++) {
+        if (i < LEGACY_ALPHABET_LEN) {
+            encoding->alphabet[i] = newenc.alphabet[i];
+            encoding->lengths[i] = encodingLength(newenc.encodings[i]);
+            encoding->codes[i] = packEncoding(newenc.encodings[i], encoding->lengths[i]);
+        } else {
+            encoding->alphabet[i] = '\0';
+            encoding->lengths[i] = 0;
+            encoding->codes[i] = 0;
+        }
+    }
+
+    return 0;
+}
+
+/*
+Read an encoding in the compact format written by writeCompactEncoding() from the current
+position of <file> into <encoding>. The encodings are reconstructed as the canonical
+encodings of the stored lengths.
+
+Returns 0 on success.
+Returns 3 if the encoding could not be read.
+*/
+int readCompactEncoding(FILE *file, Encoding *encoding) {
+    unsigned char nameLen = 0;
+    char name[MAX_NAME];
+    if (fread(&nameLen, 1, 1, file) != 1 || nameLen >= MAX_NAME) {
+        return 3;
+    }
+    if (nameLen > 0 && fread(name, nameLen, 1, file) != 1) {
+        return 3;
+    }
+    name[nameLen] = '\0';
+
+    unsigned char alphabetlenBytes[2];
+    if (fread(alphabetlenBytes, 2, 1, file) != 1) {
+        return 3;
+    }
+    int alphabetlen = alphabetlenBytes[0] | (alphabetlenBytes[1] << 8);
+    if (alphabetlen > MAX_ALPHABET_LEN) {
+        return 3;
+    }
+
+    // Every symbol is stored as its byte value followed by its encoding length
+    unsigned char entries[MAX_ALPHABET_LEN * 2];
+    if (alphabetlen > 0 && fread(entries, 2, alphabetlen, file) != (size_t) alphabetlen) {
+        return 3;
+    }
+
+    Encoding newenc;
+    strncpy(newenc.name, name, MAX_NAME);
+    newenc.alphabetlen = alphabetlen;
+    int lengths[MAX_ALPHABET_LEN];
+    for (int i = 0; i < MAX_ALPHABET_LEN; i++) {
+        newenc.alphabet[i] = i < alphabetlen ? entries[2 * i] : '\0';
+        lengths[i] = i < alphabetlen ? entries[2 * i + 1] : 0;
+        newenc.codes[i] = 0;
+        newenc.lengths[i] = 0;
+    }
+    if (assignCanonicalEncodings(&newenc, lengths) != 0) {
+        return 3;
+    }
+
+    memcpy(encoding, &newenc, sizeof(Encoding));
+    return 0;
+}
+
 /*
 Load the encoding from <filepath> into <encoding>.
 Returns 0 on success.
@@ -82,8 +295,10 @@ On error, returns:
     - 2 if the file is of invalid type
     - 3 if the encoding could not be loaded for some other reason.
 
-Files with a valid header (First 5 bytes are "HFENC") are assumed to be valid
-encodings. No check of data validity is performed besides the header.
+Files with a valid header (First 5 bytes are "HFENC") are assumed to be encodings.
+If the header is followed by ENC_FORMAT_MARKER the file is in the versioned format
+written by save() and the encodings are reconstructed from the stored lengths.
+Otherwise the file is a version 1 (legacy) file holding the raw Encoding struct data.
 
 The encoding pointed to by <encoding> has all of it's data replaced with the
 loaded data.
@@ -113,27 +328,70 @@ int load(char *filepath, Encoding *encoding) {
         return 2;
     }
 
-    Encoding newenc;
-    // Load the encoding from the file. The Encoding data should be located
-    // directly after the 5-byte header data.
-    if (fread(&newenc, sizeof(Encoding), 1, file) == 1) {
-        // Success, copy the data over
-        strncpy(encoding->name, newenc.name, MAX_NAME);
-        encoding->alphabetlen = newenc.alphabetlen;
-        for (int i = 0; i < MAX_ALPHABET_LEN; i++) {
-            encoding->alphabet[i] = newenc.alphabet[i];
-            // encoding->encodings[i] = newenc.encodings[i];
-            memcpy(encoding->encodings[i], newenc.encodings[i], sizeof(int) * MAX_ENC_SIZE_BITS);
+    unsigned char formatBytes[2];
+    int ret;
+    if (fread(formatBytes, 2, 1, file) == 1 && formatBytes[0] == ENC_FORMAT_MARKER) {
+        if (formatBytes[1] != ENC_FORMAT_VERSION) {
+            // Unknown version of the format
+            fclose(file);
+            return 2;
         }
-
-        fclose(file);
-        return 0;
+        ret = readCompactEncoding(file, encoding);
     } else {
-        // Failure to read the data
-        fclose(file);
-        return 3;
+        ret = load_legacy(file, encoding);
     }
 
+    fclose(file);
+    return ret;
+}
+
+/*
+Write <encoding> in the compact format to the current position of <file>:
+    - 1 byte name length n followed by the n bytes of the name (no null terminator)
+    - 2 byte little-endian alphabet length m
+    - m pairs of bytes: the symbol followed by the number of bits in its encoding
+
+Only the encoding lengths are written. readCompactEncoding() reconstructs the canonical
+encodings of those lengths (see assignCanonicalEncodings()).
+
+Returns the number of bytes written on success.
+Returns -1 if the encoding could not be written.
+*/
+long writeCompactEncoding(FILE *file, Encoding *encoding) {
+    if (encoding->alphabetlen < 0 || encoding->alphabetlen > MAX_ALPHABET_LEN) {
+        return -1;
+    }
+
+    unsigned char data[1 + MAX_NAME + 2 + MAX_ALPHABET_LEN * 2];
+    int dataLen = 0;
+
+    int nameLen = strnlen(encoding->name, MAX_NAME - 1);
+    data[dataLen++] = nameLen;
+    memcpy(&data[dataLen], encoding->name, nameLen);
+    dataLen += nameLen;
+
+    data[dataLen++] = encoding->alphabetlen & 0xFF;
+    data[dataLen++] = encoding->alphabetlen >> 8;
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        int length = encoding->lengths[i];
+        if (length == 0) {
+            return -1;
+        }
+        data[dataLen++] = encoding->alphabet[i];
+        data[dataLen++] = length;
+    }
+
+    if (fwrite(data, dataLen, 1, file) != 1) {
+        return -1;
+    }
+    return dataLen;
+}
+
+/*
+Returns the number of bytes writeCompactEncoding() writes for <encoding>.
+*/
+long compactEncodingSize(Encoding *encoding) {
+    return 1 + strnlen(encoding->name, MAX_NAME - 1) + 2 + 2 * encoding->alphabetlen;
 }
 
 /*
@@ -143,33 +401,26 @@ On error, returns:
     - 1 if the file could not be created
     - 2 if the encoding could not be saved for some reaons
 
-The file is saved with the 5-byte header "HFENC" immediately followed by the
-Encoding struct data. Entries in encoding.alphabet and encoding.encodings
-after index alphabetlen - 1 are zeroed.
+The file is saved in version ENC_FORMAT_VERSION of the encoding file format:
+the 5-byte header "HFENC", 1 byte ENC_FORMAT_MARKER, 1 byte ENC_FORMAT_VERSION
+and then the encoding in the compact format of writeCompactEncoding().
+
+Only the encoding lengths are saved. The file loads as the canonical encodings
+of those lengths (see assignCanonicalEncodings()), so an <encoding> that is not
+canonical must not be used to compress data that will be decompressed with the file.
 */
-int save(char *filepath, Encoding encoding) {
+int save(char *filepath, Encoding *encoding) {
     FILE *file = fopen(filepath, "wb");
     if (file == NULL) {
         return 1;
     }
 
-    // Zero the empty entries
-    for (int i = encoding.alphabetlen; i < MAX_ALPHABET_LEN; i++) {
-        encoding.alphabet[i] = '\0';
-        // encoding.encodings[i] = -1;
-        for (int j = 0; j < MAX_ENC_SIZE_BITS; j++) {
-            encoding.encodings[i][j] = ENC_END;
-        }
-    }
-
-    // Write the header bytes
-    if (fwrite(HEADER, HEADER_SIZE, 1, file) != 1) {
-        fclose(file);
-        return 2;
-    }
+    unsigned char header[HEADER_SIZE + 2];
+    memcpy(header, HEADER, HEADER_SIZE);
+    header[HEADER_SIZE] = ENC_FORMAT_MARKER;
+    header[HEADER_SIZE + 1] = ENC_FORMAT_VERSION;
 
-    // Write the encoding data
-    if (fwrite(&encoding, sizeof(Encoding), 1, file) == 1) {
+    if (fwrite(header, sizeof(header), 1, file) == 1 && writeCompactEncoding(file, encoding) >= 0) {
         // Success
         fclose(file);
         return 0;
@@ -1,20 +1,33 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <stdio.h>
+#include <stdint.h>
+
 // The maximum length of any name used as a descriptor
 #define MAX_NAME 32
 /* The maximum number of characters in an alphabet.
-This number is a bit more than the 104 keys on a standard english keyboard
-to allow for the full keyboard character range plus extra characters.
-This program is extendable to larger alphabets but would require different
-data structure implementation for larger alphabets. */
-#define MAX_ALPHABET_LEN 128
+Symbols are bytes, so an alphabet can hold every one of the 256 byte values
+(including '\0') and any binary data can be encoded. */
+#define MAX_ALPHABET_LEN 256
 // The header is the first HEADER_SIZE bytes that identify the *encoding* file
 #define HEADER_SIZE 5
 #define HEADER "HFENC"
+// In versioned encoding files, the header is followed by ENC_FORMAT_MARKER and the format version.
+// (Version 1 files have the first character of the encoding name after the header instead)
+#define ENC_FORMAT_MARKER 0xFF
+// The version of the encoding file format written by save()
+#define ENC_FORMAT_VERSION 2
 // The maximum size of any single encoding in *bits*
 #define MAX_ENC_SIZE_BITS 32
 // The maximum size of any single encoding in *bytes*
 #define MAX_ENC_SIZE_BYTES 4
-// Used to mark the end of an encoding in the encoding integer array
+// Used to mark the end of an encoding in the legacy encoding integer arrays (one int per bit)
+// stored in version 1 encoding files
 #define ENC_END -1
+// The size in bytes of a cache line. Encodings are aligned to it so the codes of the first
+// 16 symbols share a single cache line.
+#define ENC_CACHE_LINE 64
 // The footer is the last FOOTER_SIZE bytes in the *compressed* file that contain extra data
 // (like the number of padding bits in the last encoded character)
 #define FOOTER_SIZE 1
@@ -25,24 +38,30 @@ data structure implementation for larger alphabets. */
 The data type used for the encoding of an alphabet.
 Denoted by <name>.
 <alphabetlen> is the length of the alphabet.
+The encoding of alphabet[i] is the lowest <lengths>[i] bits of <codes>[i], packed in stream
+order (the first bit of the encoding is the lowest bit of the integer). Symbols without an
+encoding have a length of 0.
 */
 typedef struct encoding {
-    char name[MAX_NAME];
+    uint32_t codes[MAX_ALPHABET_LEN];
+    unsigned char lengths[MAX_ALPHABET_LEN];
+    unsigned char alphabet[MAX_ALPHABET_LEN];
     int alphabetlen;
-    char alphabet[MAX_ALPHABET_LEN];
-    int encodings[MAX_ALPHABET_LEN][MAX_ENC_SIZE_BITS];
-} Encoding;
+    char name[MAX_NAME];
+} __attribute__((aligned(ENC_CACHE_LINE))) Encoding;
 
 /*
 The data type used for the input to the encoding generation algorithm.
 Denoted by <name>.
 <alphabetlen> is the length of the alphabet
+<frequencies>[i] is the weight of alphabet[i], an integer count (such as the number of times the
+symbol occurs) so that weights add up exactly and encodings are the same on every build.
 */
 typedef struct frequencies {
     char name[MAX_NAME];
     int alphabetlen;
-    char alphabet[MAX_ALPHABET_LEN];
-    float frequencies[MAX_ALPHABET_LEN];
+    unsigned char alphabet[MAX_ALPHABET_LEN];
+    uint64_t frequencies[MAX_ALPHABET_LEN];
 } Frequencies;
 
 /*
@@ -73,6 +92,43 @@ Return 1 otherwise
 */
 int destroyFrequencies(Frequencies *freqPtr);
 
+/*
+Returns the number of bits in the legacy encoding array <enc> (one int per bit, as stored in
+version 1 encoding files).
+This is the number of entries before we reach ENC_END.
+*/
+int encodingLength(int enc[MAX_ENC_SIZE_BITS]);
+
+/*
+Returns the first <length> bits of the legacy encoding array <enc> packed into an integer
+in stream order (the first bit of the encoding is the lowest bit of the integer).
+*/
+uint32_t packEncoding(int enc[MAX_ENC_SIZE_BITS], int length);
+
+/*
+Replace the encodings in <encoding> with the canonical prefix-free encodings
+where the symbol encoding->alphabet[i] has an encoding of <lengths>[i] bits.
+
+Canonical encodings are assigned in order of increasing length, with symbols of the
+same length ordered by their byte value. Each encoding is the previous encoding
+plus one, extended with trailing zeros to the new length. The order of the alphabet
+is not changed.
+
+Returns 0 on success.
+Returns 1 if the lengths cannot form a prefix-free encoding (a length is not between
+1 and MAX_ENC_SIZE_BITS or there are too many short lengths).
+*/
+int assignCanonicalEncodings(Encoding *encoding, int lengths[MAX_ALPHABET_LEN]);
+
+/*
+Replace the encodings in <encoding> with the canonical encodings of the same lengths
+(see assignCanonicalEncodings()).
+
+Returns 0 on success.
+Returns 1 if the encoding lengths cannot form a prefix-free encoding.
+*/
+int canonicalizeEncoding(Encoding *encoding);
+
 /*
 Load the encoding from <filepath> into <encoding>.
 Returns 0 on success.
@@ -81,8 +137,10 @@ On error, returns:
     - 2 if the file is of invalid type
     - 3 if the encoding could not be loaded for some other reason.
 
-Files with a valid header (First 5 bytes are "HFENC") are assumed to be valid
-encodings. No check of data validity is performed besides the header.
+Files with a valid header (First 5 bytes are "HFENC") are assumed to be encodings.
+If the header is followed by ENC_FORMAT_MARKER the file is in the versioned format
+written by save() and the encodings are reconstructed from the stored lengths.
+Otherwise the file is a version 1 (legacy) file holding the raw Encoding struct data.
 
 The encoding pointed to by <encoding> has all of it's data replaced with the
 loaded data.
@@ -96,7 +154,43 @@ On error, returns:
     - 1 if the file could not be created
     - 2 if the encoding could not be saved for some reaons
 
-The file is saved with the 5-byte header "HFENC" immediately followed by the
-Encoding struct data.
+The file is saved in version ENC_FORMAT_VERSION of the encoding file format:
+the 5-byte header "HFENC", 1 byte ENC_FORMAT_MARKER, 1 byte ENC_FORMAT_VERSION
+and then the encoding in the compact format of writeCompactEncoding().
+
+Only the encoding lengths are saved. The file loads as the canonical encodings
+of those lengths (see assignCanonicalEncodings()), so an <encoding> that is not
+canonical must not be used to compress data that will be decompressed with the file.
+*/
+int save(char *filepath, Encoding *encoding);
+
+/*
+Write <encoding> in the compact format to the current position of <file>:
+    - 1 byte name length n followed by the n bytes of the name (no null terminator)
+    - 2 byte little-endian alphabet length m
+    - m pairs of bytes: the symbol followed by the number of bits in its encoding
+
+Only the encoding lengths are written. readCompactEncoding() reconstructs the canonical
+encodings of those lengths (see assignCanonicalEncodings()).
+
+Returns the number of bytes written on success.
+Returns -1 if the encoding could not be written.
 */
-int save(char *filepath, Encoding encoding);
\ No newline at end of file
+long writeCompactEncoding(FILE *file, Encoding *encoding);
+
+/*
+Returns the number of bytes writeCompactEncoding() writes for <encoding>.
+*/
+long compactEncodingSize(Encoding *encoding);
+
+/*
+Read an encoding in the compact format written by writeCompactEncoding() from the current
+position of <file> into <encoding>. The encodings are reconstructed as the canonical
+encodings of the stored lengths.
+
+Returns 0 on success.
+Returns 3 if the encoding could not be read.
+*/
+int readCompactEncoding(FILE *file, Encoding *encoding);
+
+#endif
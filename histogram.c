@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "histogram.h"
+
+/*
+Add the number of times every byte value occurs in the <len> bytes at <data>
+to <counts>, which is indexed by byte value.
+
+Bytes are counted round robin into four separate tables that are summed at the end.
+Runs of the same byte then increment different counters, so an increment does not
+have to wait for the previous increment of the same counter to be stored.
+*/
+void count_symbols(const unsigned char *data, size_t len, uint64_t counts[HISTOGRAM_SIZE]) {
+    uint64_t tables[4][HISTOGRAM_SIZE];
+    memset(tables, 0, sizeof(tables));
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        tables[0][data[i]]++;
+        tables[1][data[i + 1]]++;
+        tables[2][data[i + 2]]++;
+        tables[3][data[i + 3]]++;
+    }
+    for (; i < len; i++) {
+        tables[0][data[i]]++;
+    }
+
+    for (int symbol = 0; symbol < HISTOGRAM_SIZE; symbol++) {
+        counts[symbol] += tables[0][symbol] + tables[1][symbol] + tables[2][symbol]
+                          + tables[3][symbol];
+    }
+}
+
+/*
+A chunk of data to be counted by count_job() on a worker thread into its own <counts>.
+*/
+typedef struct countJob {
+    const unsigned char *data;
+    size_t len;
+    uint64_t counts[HISTOGRAM_SIZE];
+} CountJob;
+
+/*
+Helper for count_symbols_threaded().
+Count the chunk of the CountJob pointed to by <arg>. Used as a pthread start routine.
+*/
+static void *count_job(void *arg) {
+    CountJob *job = arg;
+    count_symbols(job->data, job->len, job->counts);
+    return NULL;
+}
+
+/*
+Add the number of times every byte value occurs in the <len> bytes at <data>
+to <counts>, splitting <data> into <numThreads> chunks that are counted concurrently.
+
+Returns 0 on success.
+Returns 1 if a thread could not be started.
+*/
+int count_symbols_threaded(const unsigned char *data, size_t len, int numThreads,
+                           uint64_t counts[HISTOGRAM_SIZE]) {
+    if (numThreads <= 1) {
+        count_symbols(data, len, counts);
+        return 0;
+    }
+
+    CountJob *jobs = calloc(numThreads, sizeof(CountJob));
+    pthread_t *threads = malloc(sizeof(pthread_t) * numThreads);
+    if (jobs == NULL || threads == NULL) {
+        fprintf(stderr, "Failed to allocate memory for count jobs\n");
+        exit(1);
+    }
+
+    size_t chunkLen = len / numThreads;
+    for (int i = 0; i < numThreads; i++) {
+        jobs[i].data = data + i * chunkLen;
+        // The last chunk also takes the remainder
+        jobs[i].len = i == numThreads - 1 ? len - i * chunkLen : chunkLen;
+    }
+
+    // The first chunk is counted on this thread
+    int ret = 0;
+    int numStarted = 0;
+    for (int i = 1; i < numThreads; i++) {
+        if (pthread_create(&threads[i], NULL, count_job, &jobs[i]) != 0) {
+            ret = 1;
+            break;
+        }
+        numStarted++;
+    }
+    count_job(&jobs[0]);
+    for (int i = 1; i <= numStarted; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    if (ret == 0) {
+        for (int i = 0; i < numThreads; i++) {
+            for (int symbol = 0; symbol < HISTOGRAM_SIZE; symbol++) {
+                counts[symbol] += jobs[i].counts[symbol];
+            }
+        }
+    }
+
+    free(jobs);
+    free(threads);
+    return ret;
+}
+
+/*
+Construct and return a pointer to a new frequency struct with name <name> holding every
+byte value with a nonzero count in <counts>, weighted by its count.
+*/
+Frequencies *newFrequenciesFromCounts(uint64_t counts[HISTOGRAM_SIZE], char *name) {
+    Frequencies *freqs = newFrequencies(name);
+    for (int symbol = 0; symbol < HISTOGRAM_SIZE; symbol++) {
+        if (counts[symbol] == 0) {
+            continue;
+        }
+
+        freqs->alphabet[freqs->alphabetlen] = symbol;
+        freqs->frequencies[freqs->alphabetlen] = counts[symbol];
+        freqs->alphabetlen++;
+    }
+
+    return freqs;
+}
@@ -0,0 +1,33 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "encoding.h"
+
+// The number of possible symbol (byte) values counted by the histogram functions
+#define HISTOGRAM_SIZE 256
+
+/*
+Add the number of times every byte value occurs in the <len> bytes at <data>
+to <counts>, which is indexed by byte value.
+*/
+void count_symbols(const unsigned char *data, size_t len, uint64_t counts[HISTOGRAM_SIZE]);
+
+/*
+Add the number of times every byte value occurs in the <len> bytes at <data>
+to <counts>, splitting <data> into <numThreads> chunks that are counted concurrently.
+
+Returns 0 on success.
+Returns 1 if a thread could not be started.
+*/
+int count_symbols_threaded(const unsigned char *data, size_t len, int numThreads,
+                           uint64_t counts[HISTOGRAM_SIZE]);
+
+/*
+Construct and return a pointer to a new frequency struct with name <name> holding every
+byte value with a nonzero count in <counts>, weighted by its count.
+*/
+Frequencies *newFrequenciesFromCounts(uint64_t counts[HISTOGRAM_SIZE], char *name);
+
+#endif
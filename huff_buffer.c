@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include "huff_buffer.h"
+#include "bitstream.h"
+#include "codec.h"
+
+/*
+Construct and return a pointer to the codec of <encoding>. This builds the encode and decode
+tables, so it should be done once and the codec used for every buffer.
+
+Returns NULL if <encoding> is not a valid prefix-free encoding.
+*/
+HuffCodec *newHuffCodec(const Encoding *encoding) {
+    EncodeTable *encodeTable = newEncodeTable(encoding);
+    if (encodeTable == NULL) {
+        return NULL;
+    }
+    DecodeTable *decodeTable = newDecodeTable(encoding);
+    if (decodeTable == NULL) {
+        destroyEncodeTable(encodeTable);
+        return NULL;
+    }
+
+    HuffCodec *codec = malloc(sizeof(HuffCodec));
+    if (codec == NULL) {
+        fprintf(stderr, "Failed to allocate memory for new codec struct\n");
+        exit(1);
+    }
+    codec->encodeTable = encodeTable;
+    codec->decodeTable = decodeTable;
+    codec->maxLength = 0;
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        if (encoding->lengths[i] > codec->maxLength) {
+            codec->maxLength = encoding->lengths[i];
+        }
+    }
+
+    return codec;
+}
+
+/*
+Deconstruct the codec pointed to by <codec> and free memory associated with it
+
+Return 0 on success
+Return 1 otherwise
+*/
+int destroyHuffCodec(HuffCodec *codec) {
+    destroyEncodeTable(codec->encodeTable);
+    destroyDecodeTable(codec->decodeTable);
+    free(codec);
+    return 0;
+}
+
+/*
+Helper for huff_compress_bound() and huff_compress().
+Returns the number of bytes of destination buffer needed to compress a block of <blockLen>
+bytes into <numStreams> streams with <codec>: the block header, the jump table, the encoded
+bits with up to a byte of padding for every stream and room for a whole bit buffer flush.
+*/
+static size_t block_bound(const HuffCodec *codec, size_t blockLen, int numStreams) {
+    return HUFF_BLOCK_HEADER_SIZE + CODEC_JUMP_TABLE_SIZE(numStreams)
+           + ((uint64_t) blockLen * codec->maxLength + 7) / 8 + numStreams + BIT_WRITER_SLACK;
+}
+
+/*
+Helper for huff_compress_bound(), huff_compress() and huff_decompress().
+Returns the number of streams the blocks of a frame of <srcLen> uncompressed bytes are split into.
+*/
+static int frame_streams(size_t srcLen) {
+    return srcLen >= HUFF_STREAMS_MIN_SIZE ? CODEC_STREAMS : 1;
+}
+
+/*
+Returns the number of bytes of destination buffer huff_compress() needs to compress
+<srcLen> bytes with <codec>, whatever they are.
+*/
+size_t huff_compress_bound(const HuffCodec *codec, size_t srcLen) {
+    int numStreams = frame_streams(srcLen);
+    size_t bound = HUFF_FRAME_HEADER_SIZE
+                   + srcLen / HUFF_BLOCK_SIZE * block_bound(codec, HUFF_BLOCK_SIZE, numStreams);
+    if (srcLen % HUFF_BLOCK_SIZE != 0) {
+        bound += block_bound(codec, srcLen % HUFF_BLOCK_SIZE, numStreams);
+    }
+    return bound;
+}
+
+/*
+Compress the <srcLen> bytes at <src> with <codec> into a frame written to the <dstCap> bytes
+at <dst>. A <dstCap> of huff_compress_bound(codec, srcLen) always suffices, and a smaller one
+may fail even if the frame would fit.
+
+Every block is encoded straight into <dst> once the room left is known to hold the block's
+bound, so the blocks need no buffer of their own.
+
+Returns the size of the frame on success.
+Returns HUFF_ERROR_ALPHABET if a byte of <src> is not in the encoding alphabet.
+Returns HUFF_ERROR_DST_SIZE if <dst> is too small.
+*/
+long huff_compress(const HuffCodec *codec, const void *src, size_t srcLen, void *dst,
+                   size_t dstCap) {
+    const unsigned char *input = src;
+    unsigned char *output = dst;
+    if (dstCap < HUFF_FRAME_HEADER_SIZE || srcLen > LONG_MAX) {
+        return HUFF_ERROR_DST_SIZE;
+    }
+
+    int numStreams = frame_streams(srcLen);
+    store_le64(output, srcLen);
+    output[8] = numStreams;
+    size_t outputPos = HUFF_FRAME_HEADER_SIZE;
+
+    for (size_t start = 0; start < srcLen; start += HUFF_BLOCK_SIZE) {
+        size_t blockLen = srcLen - start < HUFF_BLOCK_SIZE ? srcLen - start : HUFF_BLOCK_SIZE;
+        if (dstCap - outputPos < block_bound(codec, blockLen, numStreams)) {
+            return HUFF_ERROR_DST_SIZE;
+        }
+
+        long encodedLen = encode_block_streams(codec->encodeTable, input + start, blockLen,
+                                               numStreams, output + outputPos + HUFF_BLOCK_HEADER_SIZE);
+        if (encodedLen < 0) {
+            return HUFF_ERROR_ALPHABET;
+        }
+        for (int j = 0; j < HUFF_BLOCK_HEADER_SIZE; j++) {
+            output[outputPos + j] = (uint64_t) encodedLen >> (8 * j);
+        }
+        outputPos += HUFF_BLOCK_HEADER_SIZE + encodedLen;
+    }
+
+    return outputPos;
+}
+
+/*
+Returns the number of uncompressed bytes of the frame in the <srcLen> bytes at <src>.
+Returns HUFF_ERROR_CORRUPT if <src> is too short to hold a frame header.
+*/
+long huff_decompressed_size(const void *src, size_t srcLen) {
+    if (srcLen < HUFF_FRAME_HEADER_SIZE) {
+        return HUFF_ERROR_CORRUPT;
+    }
+    uint64_t size = load_le64(src);
+    return size <= LONG_MAX ? (long) size : HUFF_ERROR_CORRUPT;
+}
+
+/*
+Decompress the frame in the <srcLen> bytes at <src>, compressed with the encoding of <codec>,
+into the <dstCap> bytes at <dst>.
+
+Every block is decoded straight from <src> into its place in <dst> (see decode_block_streams()).
+
+Returns the number of uncompressed bytes written to <dst> on success.
+Returns HUFF_ERROR_DST_SIZE if <dst> is smaller than the uncompressed data
+(see huff_decompressed_size()).
+Returns HUFF_ERROR_CORRUPT if <src> is not a valid frame.
+*/
+long huff_decompress(const HuffCodec *codec, const void *src, size_t srcLen, void *dst,
+                     size_t dstCap) {
+    const unsigned char *input = src;
+    unsigned char *output = dst;
+    long size = huff_decompressed_size(src, srcLen);
+    if (size < 0) {
+        return HUFF_ERROR_CORRUPT;
+    }
+    int numStreams = input[8];
+    if (numStreams != frame_streams(size)) {
+        return HUFF_ERROR_CORRUPT;
+    }
+    if ((size_t) size > dstCap) {
+        return HUFF_ERROR_DST_SIZE;
+    }
+
+    size_t inputPos = HUFF_FRAME_HEADER_SIZE;
+    for (size_t start = 0; start < (size_t) size; start += HUFF_BLOCK_SIZE) {
+        size_t blockLen = size - start < HUFF_BLOCK_SIZE ? size - start : HUFF_BLOCK_SIZE;
+        if (srcLen - inputPos < HUFF_BLOCK_HEADER_SIZE) {
+            return HUFF_ERROR_CORRUPT;
+        }
+        size_t encodedLen = 0;
+        for (int j = 0; j < HUFF_BLOCK_HEADER_SIZE; j++) {
+            encodedLen |= (size_t) input[inputPos + j] << (8 * j);
+        }
+        inputPos += HUFF_BLOCK_HEADER_SIZE;
+        if (encodedLen > srcLen - inputPos) {
+            return HUFF_ERROR_CORRUPT;
+        }
+
+        if (decode_block_streams(codec->decodeTable, input + inputPos, encodedLen, numStreams,
+                                 output + start, blockLen) != 0) {
+            return HUFF_ERROR_CORRUPT;
+        }
+        inputPos += encodedLen;
+    }
+
+    if (inputPos != srcLen) {
+        return HUFF_ERROR_CORRUPT;
+    }
+    return size;
+}
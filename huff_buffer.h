@@ -0,0 +1,108 @@
+#ifndef HUFF_BUFFER_H
+#define HUFF_BUFFER_H
+
+#include <stddef.h>
+#include "encoding.h"
+#include "encode_table.h"
+#include "decode_table.h"
+
+/*
+The frame format written by huff_compress():
+    - 8 byte number of uncompressed bytes n
+    - 1 byte number of interleaved streams every block is encoded as: CODEC_STREAMS if n is at
+      least HUFF_STREAMS_MIN_SIZE and 1 otherwise (see encode_block_streams())
+    - a block for every HUFF_BLOCK_SIZE bytes of the uncompressed data (the last block holds the
+      rest): the 4 byte size of the block's encoded streams followed by the streams
+All integers are stored little-endian.
+
+Unlike the container (see container.h), a frame does not carry its encoding. It must be
+decompressed with a codec compiled from the encoding it was compressed with.
+*/
+#define HUFF_FRAME_HEADER_SIZE 9
+#define HUFF_BLOCK_HEADER_SIZE 4
+// The maximum number of uncompressed bytes in a block of a frame
+#define HUFF_BLOCK_SIZE (1 << 20)
+// The smallest input that is split into CODEC_STREAMS streams. The jump table of smaller inputs
+// would cost more than interleaving saves.
+#define HUFF_STREAMS_MIN_SIZE 4096
+
+// The errors returned by huff_compress() and huff_decompress()
+// A symbol of the input is not in the encoding alphabet
+#define HUFF_ERROR_ALPHABET -1
+// The destination buffer is too small
+#define HUFF_ERROR_DST_SIZE -2
+// The input is not a valid frame of the codec's encoding
+#define HUFF_ERROR_CORRUPT -3
+
+/*
+An encoding compiled for compressing and decompressing buffers.
+<encodeTable> and <decodeTable> are the tables of the encoding and <maxLength> is the length
+of its longest encoding in bits.
+
+A codec is never modified after newHuffCodec() returns it, so any number of threads can share
+one codec.
+*/
+typedef struct huff_codec {
+    EncodeTable *encodeTable;
+    DecodeTable *decodeTable;
+    int maxLength;
+} HuffCodec;
+
+/*
+Construct and return a pointer to the codec of <encoding>. This builds the encode and decode
+tables, so it should be done once and the codec used for every buffer.
+
+Returns NULL if <encoding> is not a valid prefix-free encoding.
+*/
+HuffCodec *newHuffCodec(const Encoding *encoding);
+
+/*
+Deconstruct the codec pointed to by <codec> and free memory associated with it
+
+Return 0 on success
+Return 1 otherwise
+*/
+int destroyHuffCodec(HuffCodec *codec);
+
+/*
+Returns the number of bytes of destination buffer huff_compress() needs to compress
+<srcLen> bytes with <codec>, whatever they are.
+*/
+size_t huff_compress_bound(const HuffCodec *codec, size_t srcLen);
+
+/*
+Compress the <srcLen> bytes at <src> with <codec> into a frame written to the <dstCap> bytes
+at <dst>. A <dstCap> of huff_compress_bound(codec, srcLen) always suffices, and a smaller one
+may fail even if the frame would fit.
+
+Nothing is allocated and only <dst> is written, so any number of threads can compress at once.
+
+Returns the size of the frame on success.
+Returns HUFF_ERROR_ALPHABET if a byte of <src> is not in the encoding alphabet.
+Returns HUFF_ERROR_DST_SIZE if <dst> is too small.
+*/
+long huff_compress(const HuffCodec *codec, const void *src, size_t srcLen, void *dst,
+                   size_t dstCap);
+
+/*
+Returns the number of uncompressed bytes of the frame in the <srcLen> bytes at <src>.
+Returns HUFF_ERROR_CORRUPT if <src> is too short to hold a frame header.
+*/
+long huff_decompressed_size(const void *src, size_t srcLen);
+
+/*
+Decompress the frame in the <srcLen> bytes at <src>, compressed with the encoding of <codec>,
+into the <dstCap> bytes at <dst>.
+
+Nothing is allocated and only <dst> is written, so any number of threads can decompress at once.
+
+Returns the number of uncompressed bytes written to <dst> on success.
+Returns HUFF_ERROR_DST_SIZE if <dst> is smaller than the uncompressed data
+(see huff_decompressed_size()).
+Returns HUFF_ERROR_CORRUPT if <src> is not exactly a valid frame. A frame compressed with
+another encoding is usually found to be corrupt, but may also decode to the wrong bytes.
+*/
+long huff_decompress(const HuffCodec *codec, const void *src, size_t srcLen, void *dst,
+                     size_t dstCap);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef HUFFMAN_H
+#define HUFFMAN_H
+
+/*
+The public interface of libhuffman (see "make lib"), the compression engine of the encoder
+without its command line:
+    - encoding.h: encodings and their load() and save() to encoding files
+    - histogram.h and huffman_coding.h: counting symbols and generating encodings from the counts
+    - encode_table.h, decode_table.h and codec.h: the tables and the block codecs
+    - container.h: the compressed container format
+    - compressor.h: compressing and decompressing whole files
+    - huff_buffer.h: compressing and decompressing buffers in memory
+    - batch.h: compressing and decompressing batches of files on a pool of threads
+*/
+#include "encoding.h"
+#include "histogram.h"
+#include "huffman_coding.h"
+#include "encode_table.h"
+#include "decode_table.h"
+#include "codec.h"
+#include "container.h"
+#include "compressor.h"
+#include "huff_buffer.h"
+#include "batch.h"
+
+#endif
@@ -3,107 +3,346 @@
 #include <string.h>
 #include "huffman_coding.h"
 
+/*
+An item of a sorted list of weights: either the leaf of symbol <symbol> (the index of the
+symbol in the alphabet) or, in package-merge lists, a package of two items of the next
+list (<symbol> is -1).
+*/
+typedef struct package_item {
+    uint64_t weight;
+    int symbol;
+} PackageItem;
+
+/*
+Helper for generateSortedEncoding() and generateLengthLimitedEncoding().
+Compare the leaves pointed to by <a> and <b> by weight and then by symbol position.
+Used with qsort.
+*/
+static int compareLeaves(const void *a, const void *b) {
+    const PackageItem *itemA = a;
+    const PackageItem *itemB = b;
+    if (itemA->weight != itemB->weight) {
+        return itemA->weight < itemB->weight ? -1 : 1;
+    }
+    return itemA->symbol - itemB->symbol;
+}
+
 /*
 Helper method for generateEncoding.
 
-Traverses the binary tree with root at <root> and fills the <encoding> with the prefix-free
-encoding and alphabet details.
+Walks the binary <tree> from its root and fills the <encoding> with the prefix-free
+encoding and alphabet details. Every left branch corresponds to a 0 and every right branch
+corresponds to a 1 for a symbol's encoding. The symbols are added to the alphabet in the
+order their leaf nodes were added to the tree.
 
-<currEncoding> is an array specifying the current prefix-free encoding based on the branches we are
-on with index 0 being the leftmost digit of the encoding and -1 indicating the end of the current
-encoding.
+Children are always stored before their parent, so a single pass from the root (the last node)
+to the first node visits every parent before its children. The depth and encoding bits of
+every node are kept in arrays indexed like the node array instead of recursing.
 
-<encodingCurrPos> is the index of the current branching part of the <currEncoding> array and is
-equal to the depth we are at in the binary tree.
+Returns 0 on success.
+Returns 1 if a leaf is deeper than MAX_ENC_SIZE_BITS.
 */
-void traverseEncodingTree(Encoding *encoding, Tree *root, int currEncoding[], int encodingCurrPos) {
-    if (root->symbol != '\0') {
-        // We've reached a leaf node containing a real symbol instead of a dummy symbol
-        // Add this symbol to the next available spot and record the encoding associated with it
-        encoding->alphabet[encoding->alphabetlen] = root->symbol;
-        // Copy the encoding bits over
-        for (int i = 0; i < MAX_ENC_SIZE_BITS; i++) {
-            encoding->encodings[encoding->alphabetlen][i] = currEncoding[i];
+static int traverseEncodingTree(Encoding *encoding, Tree *tree) {
+    int depths[MAX_TREE_NODES];
+    // The encoding of every node packed in stream order (the first branch is the lowest bit)
+    uint32_t codes[MAX_TREE_NODES];
+
+    int root = tree->numNodes - 1;
+    depths[root] = 0;
+    codes[root] = 0;
+    int ret = 0;
+    for (int i = root; i >= 0; i--) {
+        TreeNode *node = &tree->nodes[i];
+        if (node->leaf) {
+            continue;
         }
+        if (depths[i] == MAX_ENC_SIZE_BITS) {
+            ret = 1;
+            break;
+        }
+        // Left branch is 0, right branch is 1
+        depths[node->left] = depths[i] + 1;
+        codes[node->left] = codes[i];
+        depths[node->right] = depths[i] + 1;
+        codes[node->right] = codes[i] | (1u << depths[i]);
+    }
+
+    for (int i = 0; i < tree->numNodes && ret == 0; i++) {
+        TreeNode *node = &tree->nodes[i];
+        if (!node->leaf) {
+            continue;
+        }
+        // Add this symbol to the next available spot and record the encoding associated with it
+        encoding->alphabet[encoding->alphabetlen] = node->symbol;
+        encoding->codes[encoding->alphabetlen] = codes[i];
+        encoding->lengths[encoding->alphabetlen] = depths[i];
         encoding->alphabetlen++;
+    }
+
+    return ret;
+}
 
-        return;
+/*
+Helper method for generateEncoding and generateSortedEncoding.
+Returns a pointer to the encoding read off the Huffman <tree> built from <freqs>, named
+<encodingName>.
+
+Parse the tree into a prefix-free encoding as follows:
+Starting at the root, every left branch corresponds to a 0
+and every right branch corresponds to a 1 for a symbol's encoding
+*/
+static Encoding *encodingFromTree(Tree *tree, Frequencies freqs, char encodingName[MAX_NAME]) {
+    Encoding *encoding = newEncoding(encodingName);
+    int ret = traverseEncodingTree(encoding, tree);
+
+    // Encodings longer than MAX_ENC_SIZE_BITS cannot be stored
+    if (ret != 0) {
+        destroyEncoding(encoding);
+        return generateLengthLimitedEncoding(freqs, encodingName, MAX_ENC_SIZE_BITS);
     }
 
-    // Recursively examine the left and right children
-    // Left branch is 0
-    currEncoding[encodingCurrPos] = 0;
-    traverseEncodingTree(encoding, root->left, currEncoding, encodingCurrPos + 1);
-    // Right branch is 1
-    currEncoding[encodingCurrPos] = 1;
-    traverseEncodingTree(encoding, root->right, currEncoding, encodingCurrPos + 1);
-    // After doing the recursive calls, set the currEncoding for this branch back to -1
-    // so that other recursive calls at this depth have the correct encoding.
-    currEncoding[encodingCurrPos] = -1;
+    return encoding;
 }
 
 /*
 Run the Huffman Coding algorithm to create a prefix-free encoding given
 a set of symbols and associated frequencies
 
-There must be at least two symbols in <freqs>
+Items of equal weight are merged in order of their tree node index (see QueueItem), so the
+encoding only depends on <freqs> and not on the order the heap happens to hold ties in.
+
+An alphabet of a single symbol is given the 1 bit encoding 0.
+If the Huffman tree is deeper than MAX_ENC_SIZE_BITS (very skewed frequencies), the
+encoding is instead the canonical length-limited encoding of MAX_ENC_SIZE_BITS bits
+(see generateLengthLimitedEncoding()).
 */
 Encoding *generateEncoding(Frequencies freqs, char encodingName[MAX_NAME]) {
+    // With fewer than two symbols there is no tree to build
+    if (freqs.alphabetlen < 2) {
+        Encoding *encoding = newEncoding(encodingName);
+        if (freqs.alphabetlen == 1) {
+            encoding->alphabet[0] = freqs.alphabet[0];
+            encoding->codes[0] = 0;
+            encoding->lengths[0] = 1;
+            encoding->alphabetlen = 1;
+        }
+        return encoding;
+    }
+
     // Construct the priority queue form the symbols in freqs
-    // Each symbol's weight is the frequency provided
-    PriorityQueue *pqueue = newQueue(freqs.alphabetlen);
+    // Each symbol's weight is the frequency provided and each symbol gets a leaf node.
+    // The tree and the queue never hold more than the nodes and items of MAX_ALPHABET_LEN
+    // symbols, so they are built on the stack without allocating.
+    // The leaves are ordered into a heap all at once instead of being enqueued one by one.
+    Tree tree;
+    initTree(&tree);
+    QueueItem leaves[MAX_ALPHABET_LEN];
     for (int i = 0; i < freqs.alphabetlen; i++) {
-        // Method newQueueItem does not malloc a new queueitem struct so this calling method
-        // does not create a memory leak by passing the struct into enqueue
-        enqueue(pqueue, newQueueItem(freqs.alphabet[i], freqs.frequencies[i], NULL));
+        int leaf = addLeafNode(&tree, freqs.alphabet[i]);
+        leaves[i] = newQueueItem(freqs.alphabet[i], freqs.frequencies[i], leaf);
     }
+    uint64_t queueWeights[MAX_ALPHABET_LEN];
+    QueueNode queueNodes[MAX_ALPHABET_LEN];
+    PriorityQueue queue;
+    PriorityQueue *pqueue = &queue;
+    initQueue(pqueue, queueWeights, queueNodes, MAX_ALPHABET_LEN, QUEUE_ARITY);
+    heapify(pqueue, leaves, freqs.alphabetlen);
 
     /*
     Main Huffman Coding algorithm:
     - While the queue contains at least 2 items, take the two items with the lowest weight
       out of the queue.
-    - Create a new tree node with the two items as the children and the symbol '\0' (Null
-      terminator will be used to indicate dummy symbol as this symbol should not exist in
-      any alphabet the user provides).
+    - Create a new internal tree node with the two items as the children. Internal nodes are
+      flagged as not being leaves, so their dummy symbol '\0' does not collide with a real
+      '\0' symbol in the alphabet.
     - If the queue now contains 0 items, the tree node we just created is the root of the
       prefix-free encoding tree we created so we parse this to create the encoding.
     - Otherwise (queue nonempty) we insert a new QueueItem into the priority queue with the combined
-      weight of the two symbols or dummy symbols we took out and with a pointer to the tree node
-      we created. This QueueItem will have symbol '\0' like the tree node to indicate that it is
-      a dummy symbol.
+      weight of the two symbols or dummy symbols we took out and with the index of the tree node
+      we created. This QueueItem will have the dummy symbol '\0' like the tree node.
     */
-    Tree *lastTreeNodeCreated = NULL;
     do {
         QueueItem item1 = dequeue(pqueue);
         QueueItem item2 = dequeue(pqueue);
 
-        lastTreeNodeCreated = newTree('\0');
-        lastTreeNodeCreated->left = item1.treeNode;
-        lastTreeNodeCreated->right = item2.treeNode;
+        int node = addInternalNode(&tree, item1.treeNode, item2.treeNode);
 
-        enqueue(pqueue, newQueueItem('\0', item1.weight + item2.weight, lastTreeNodeCreated));
+        enqueue(pqueue, newQueueItem('\0', item1.weight + item2.weight, node));
     } while (pqueue->length >= 2);
 
-    // If the last tree node created is a NULL pointer, the do-while loop didn't run (less than 2
-    // elements) or something went wrong with a Malloc call and wasn't caught in the allocation
-    // method for a new Tree
-    if (lastTreeNodeCreated == NULL) {
-        fprintf(stderr, "Invalid alphabet length or error allocating space for new Tree\n");
+    return encodingFromTree(&tree, freqs, encodingName);
+}
+
+/*
+Run the Huffman Coding algorithm to create a prefix-free encoding given
+a set of symbols and associated frequencies, in linear time after sorting the symbols.
+
+The symbols are sorted by weight once. Internal tree nodes are created in order of
+nondecreasing weight, so they form a second sorted queue, and the two lightest items are
+always at the fronts of the two queues. Each merge then takes constant time instead of the
+logarithmic time of the heap used by generateEncoding(). Both builders merge items of equal
+weight in the same order (leaves by alphabet position before internal nodes by creation
+order), so they build the same tree.
+
+An alphabet of a single symbol is given the 1 bit encoding 0.
+If the Huffman tree is deeper than MAX_ENC_SIZE_BITS (very skewed frequencies), the
+encoding is instead the canonical length-limited encoding of MAX_ENC_SIZE_BITS bits
+(see generateLengthLimitedEncoding()).
+*/
+Encoding *generateSortedEncoding(Frequencies freqs, char encodingName[MAX_NAME]) {
+    int n = freqs.alphabetlen;
+    if (n < 2) {
+        return generateEncoding(freqs, encodingName);
     }
 
-    /*
-    Parse the tree into a prefix-free encoding as follows:
-    Starting at the root, every left branch corresponds to a 0
-    and every right branch corresponds to a 1 for a symbol's encoding
-    Perform a binary tree traversal and keep track of which branch is taken for each symbol
-    */
-    Encoding *encoding = newEncoding(encodingName);
+    // Leaves are added in alphabet order so leaf i is node i and internal node k is node n + k
+    Tree tree;
+    initTree(&tree);
+    PackageItem leaves[MAX_ALPHABET_LEN];
+    uint64_t internalWeights[MAX_ALPHABET_LEN - 1];
+    for (int i = 0; i < n; i++) {
+        addLeafNode(&tree, freqs.alphabet[i]);
+        leaves[i].weight = freqs.frequencies[i];
+        leaves[i].symbol = i;
+    }
+    qsort(leaves, n, sizeof(PackageItem), compareLeaves);
+
+    int nextLeaf = 0;
+    int nextInternal = 0;
+    for (int numInternal = 0; numInternal < n - 1; numInternal++) {
+        // Take the two lightest items from the fronts of the queues (leaves first on equal weights)
+        int children[2];
+        uint64_t weight = 0;
+        for (int c = 0; c < 2; c++) {
+            if (nextLeaf < n && (nextInternal == numInternal
+                                 || leaves[nextLeaf].weight <= internalWeights[nextInternal])) {
+                children[c] = leaves[nextLeaf].symbol;
+                weight += leaves[nextLeaf].weight;
+                nextLeaf++;
+            } else {
+                children[c] = n + nextInternal;
+                weight += internalWeights[nextInternal];
+                nextInternal++;
+            }
+        }
+
+        addInternalNode(&tree, children[0], children[1]);
+        internalWeights[numInternal] = weight;
+    }
+
+    return encodingFromTree(&tree, freqs, encodingName);
+}
+
+/*
+Run the Huffman Coding algorithm to create a prefix-free encoding given
+a set of symbols and associated frequencies, with the encodings replaced by the
+canonical encodings of the same lengths (see assignCanonicalEncodings()).
+The tree is built with the linear time builder of generateSortedEncoding().
+
+Canonical encodings are fully described by their lengths so they can be saved with save()
+*/
+Encoding *generateCanonicalEncoding(Frequencies freqs, char encodingName[MAX_NAME]) {
+    Encoding *encoding = generateSortedEncoding(freqs, encodingName);
+
+    // The Huffman tree encoding lengths always satisfy the prefix-free requirements
+    // so reassigning canonical encodings of the same lengths cannot fail
+    canonicalizeEncoding(encoding);
+
+    return encoding;
+}
+
+/*
+Create the prefix-free encoding with no encoding longer than <maxLength> bits
+that has the shortest total encoded size for a set of symbols and associated frequencies,
+with canonical encodings (see assignCanonicalEncodings()).
+
+The encoding lengths are found with the package-merge algorithm. The list for the
+longest length holds a leaf for every symbol sorted by weight. Every shorter length's list
+merges the leaves with packages of adjacent pairs of the list of the next longer length.
+The 2n - 2 lightest items of the shortest length's list make up the encoding: every time a
+symbol's leaf is among the chosen items of a list (following chosen packages into the longer
+lists), its encoding gets one bit longer.
+
+An alphabet of a single symbol is given the 1 bit encoding 0.
+
+Returns NULL if <maxLength> is not between 1 and MAX_ENC_SIZE_BITS or there are more
+symbols than encodings of <maxLength> bits.
+*/
+Encoding *generateLengthLimitedEncoding(Frequencies freqs, char encodingName[MAX_NAME],
+                                        int maxLength) {
+    int n = freqs.alphabetlen;
+    if (maxLength < 1 || maxLength > MAX_ENC_SIZE_BITS || n > (1L << maxLength)) {
+        return NULL;
+    }
+    if (n < 2) {
+        return generateCanonicalEncoding(freqs, encodingName);
+    }
+
+    // lists[j] is the list of the items for encodings of length j + 1 (j = maxLength - 1 is the
+    // longest) and listLens[j] is its number of items
+    PackageItem *lists = malloc(sizeof(PackageItem) * maxLength * 2 * n);
+    int *listLens = malloc(sizeof(int) * maxLength);
+    if (lists == NULL || listLens == NULL) {
+        fprintf(stderr, "Failed to allocate memory for package-merge lists\n");
+        exit(1);
+    }
 
-    int currEncoding[MAX_ENC_SIZE_BITS];
-    for (int i = 0; i < MAX_ENC_SIZE_BITS; i++) {
-        currEncoding[i] = ENC_END;
+    PackageItem *leaves = &lists[(maxLength - 1) * 2 * n];
+    for (int i = 0; i < n; i++) {
+        leaves[i].weight = freqs.frequencies[i];
+        leaves[i].symbol = i;
     }
-    traverseEncodingTree(encoding, lastTreeNodeCreated, currEncoding, 0);
+    qsort(leaves, n, sizeof(PackageItem), compareLeaves);
+    listLens[maxLength - 1] = n;
+
+    for (int j = maxLength - 2; j >= 0; j--) {
+        PackageItem *list = &lists[j * 2 * n];
+        PackageItem *next = &lists[(j + 1) * 2 * n];
+        int numPackages = listLens[j + 1] / 2;
+
+        // Merge the leaves with the packages (leaves go first on equal weights)
+        int leafi = 0;
+        int packagei = 0;
+        int len = 0;
+        while (leafi < n || packagei < numPackages) {
+            uint64_t packageWeight = packagei < numPackages
+                                   ? next[2 * packagei].weight + next[2 * packagei + 1].weight : 0;
+            if (packagei == numPackages || (leafi < n && leaves[leafi].weight <= packageWeight)) {
+                list[len++] = leaves[leafi++];
+            } else {
+                list[len].weight = packageWeight;
+                list[len].symbol = -1;
+                len++;
+                packagei++;
+            }
+        }
+        listLens[j] = len;
+    }
+
+    // Follow the chosen items through the lists, counting the chosen leaves of every symbol
+    int lengths[MAX_ALPHABET_LEN];
+    memset(lengths, 0, sizeof(lengths));
+    int numChosen = 2 * n - 2;
+    for (int j = 0; j < maxLength && numChosen > 0; j++) {
+        PackageItem *list = &lists[j * 2 * n];
+        int numPackages = 0;
+        for (int i = 0; i < numChosen; i++) {
+            if (list[i].symbol == -1) {
+                numPackages++;
+            } else {
+                lengths[list[i].symbol]++;
+            }
+        }
+        numChosen = 2 * numPackages;
+    }
+    free(lists);
+    free(listLens);
+
+    Encoding *encoding = newEncoding(encodingName);
+    encoding->alphabetlen = n;
+    memcpy(encoding->alphabet, freqs.alphabet, n);
+    // Package-merge lengths always satisfy the prefix-free requirements
+    assignCanonicalEncodings(encoding, lengths);
 
     return encoding;
 }
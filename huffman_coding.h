@@ -1,8 +1,56 @@
+#ifndef HUFFMAN_CODING_H
+#define HUFFMAN_CODING_H
+
 #include "encoding.h"
 #include "priority_queue.h"
 
 /*
 Run the Huffman Coding algorithm to create a prefix-free encoding given
 a set of symbols and associated frequencies
+Items of equal weight are merged in order of their tree node index, so the encoding is
+the same for the same <freqs> on every run.
+
+An alphabet of a single symbol is given the 1 bit encoding 0.
+If the Huffman tree is deeper than MAX_ENC_SIZE_BITS (very skewed frequencies), the
+encoding is instead the canonical length-limited encoding of MAX_ENC_SIZE_BITS bits
+(see generateLengthLimitedEncoding()).
+*/
+Encoding *generateEncoding(Frequencies freqs, char encodingName[MAX_NAME]);
+
+/*
+Run the Huffman Coding algorithm to create a prefix-free encoding given
+a set of symbols and associated frequencies, in linear time after sorting the symbols.
+Internal tree nodes are taken from a second sorted queue instead of a heap.
+Ties are broken the same way as in generateEncoding(), so the encodings are the same.
+
+An alphabet of a single symbol is given the 1 bit encoding 0.
+If the Huffman tree is deeper than MAX_ENC_SIZE_BITS, the encoding is instead the
+canonical length-limited encoding of MAX_ENC_SIZE_BITS bits.
+*/
+Encoding *generateSortedEncoding(Frequencies freqs, char encodingName[MAX_NAME]);
+
+/*
+Run the Huffman Coding algorithm to create a prefix-free encoding given
+a set of symbols and associated frequencies, with the encodings replaced by the
+canonical encodings of the same lengths (see assignCanonicalEncodings()).
+The tree is built with the linear time builder of generateSortedEncoding().
+
+Canonical encodings are fully described by their lengths so they can be saved with save()
 */
-Encoding *generateEncoding(Frequencies freqs, char encodingName[MAX_NAME]);
\ No newline at end of file
+Encoding *generateCanonicalEncoding(Frequencies freqs, char encodingName[MAX_NAME]);
+
+/*
+Create the prefix-free encoding with no encoding longer than <maxLength> bits
+that has the shortest total encoded size for a set of symbols and associated frequencies,
+with canonical encodings (see assignCanonicalEncodings()). The lengths are found with
+the package-merge algorithm.
+
+An alphabet of a single symbol is given the 1 bit encoding 0.
+
+Returns NULL if <maxLength> is not between 1 and MAX_ENC_SIZE_BITS or there are more
+symbols than encodings of <maxLength> bits.
+*/
+Encoding *generateLengthLimitedEncoding(Frequencies freqs, char encodingName[MAX_NAME],
+                                        int maxLength);
+
+#endif
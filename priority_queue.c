@@ -3,117 +3,216 @@
 #include "priority_queue.h"
 
 /*
-Initializes and returns a pointer to a new Tree with <symbol> and no children.
+Initializes the Tree pointed to by <tree> to an empty tree
 */
-Tree *newTree(char symbol) {
-    Tree *tree = malloc(sizeof(Tree));
-    if (tree == NULL) {
-        fprintf(stderr, "Failed to allocate memory for a new Tree in a QueueItem\n");
-        exit(1);
+void initTree(Tree *tree) {
+    tree->numNodes = 0;
+}
+
+/*
+Add a leaf node with <symbol> to <tree>.
+
+Returns the index of the new node.
+Returns -1 if <tree> is full.
+*/
+int addLeafNode(Tree *tree, unsigned char symbol) {
+    if (tree->numNodes == MAX_TREE_NODES) {
+        return -1;
     }
 
-    tree->symbol = symbol;
-    tree->left = NULL;
-    tree->right = NULL;
+    TreeNode *node = &tree->nodes[tree->numNodes];
+    node->symbol = symbol;
+    node->leaf = 1;
+    node->left = -1;
+    node->right = -1;
+    return tree->numNodes++;
+}
 
-    return tree;
+/*
+Add an internal node with the children at indices <left> and <right> to <tree>.
+
+Returns the index of the new node.
+Returns -1 if <tree> is full.
+*/
+int addInternalNode(Tree *tree, int left, int right) {
+    if (tree->numNodes == MAX_TREE_NODES) {
+        return -1;
+    }
+
+    TreeNode *node = &tree->nodes[tree->numNodes];
+    node->symbol = '\0';
+    node->leaf = 0;
+    node->left = left;
+    node->right = right;
+    return tree->numNodes++;
 }
 
 /*
-Initializes and returns a new nonempty QueueItem.
-If <treeNode> is NULL, a new Tree struct will be allocated with <symbol> and no children
+Initializes and returns a new QueueItem for the tree node at index <treeNode>
 */
-QueueItem newQueueItem(char symbol, float weight, Tree *treeNode) {
+QueueItem newQueueItem(unsigned char symbol, uint64_t weight, int treeNode) {
     QueueItem item;
     item.symbol = symbol;
     item.weight = weight;
-    item.empty = 0;
-    if (treeNode == NULL) {
-        item.treeNode = newTree(symbol);
-    } else {
-        item.treeNode = treeNode;
-    }
+    item.treeNode = treeNode;
     return item;
 }
 
 /*
-Initializes and returns a pointer to a new priority queue
+Initializes the priority queue pointed to by <pqueue> to an empty queue of at most
+<maxQueueLength> items stored in <weights> and <nodes>, which must each hold <maxQueueLength>
+entries, whose heap nodes have <arity> (at least 2) children
+*/
+void initQueue(PriorityQueue *pqueue, uint64_t *weights, QueueNode *nodes, int maxQueueLength,
+               int arity) {
+    pqueue->weights = weights;
+    pqueue->nodes = nodes;
+    pqueue->arity = arity < 2 ? 2 : arity;
+    pqueue->maxQueueLength = maxQueueLength;
+    pqueue->length = 0;
+}
+
+/*
+Initializes and returns a pointer to a new empty priority queue of at most <maxQueueLength>
+items whose heap nodes have <arity> (at least 2) children
 */
-PriorityQueue *newQueue(int maxQueueLength) {
+PriorityQueue *newQueue(int maxQueueLength, int arity) {
     PriorityQueue *pqueue = malloc(sizeof(PriorityQueue));
     if (pqueue == NULL) {
         fprintf(stderr, "Failed to allocate memory for a priority queue\n");
         exit(1);
     }
 
-    pqueue->maxQueueLength = maxQueueLength;
-    pqueue->length = 0;
-    pqueue->queue = malloc(sizeof(QueueItem) * maxQueueLength);
-    if (pqueue->queue == NULL) {
+    uint64_t *weights = malloc(sizeof(uint64_t) * maxQueueLength);
+    QueueNode *nodes = malloc(sizeof(QueueNode) * maxQueueLength);
+    if (weights == NULL || nodes == NULL) {
         fprintf(stderr, "Failed to allocate memory for new priority queue array\n");
         exit(1);
     }
-
-    // Initialize every queueitem. 
-    for (int i = 0; i < maxQueueLength; i++) {
-        pqueue->queue[i].symbol = '\0';
-        pqueue->queue[i].weight = 0.0;
-        pqueue->queue[i].empty = 1;
-        pqueue->queue[i].treeNode = NULL;
-    }
+    initQueue(pqueue, weights, nodes, maxQueueLength, arity);
 
     return pqueue;
 }
 
 /*
-Enqueue method for the priority queue
+Deconstruct the priority queue returned by newQueue() pointed to by <pqueue> and free memory
+associated with it
 
-Returns 0 if successful
-Returns 1 if queue is full
+Return 0 on success
+Return 1 otherwise
 */
-int enqueue(PriorityQueue *pqueue, QueueItem item) {
-    // Min-Heap based implementation
+int destroyQueue(PriorityQueue *pqueue) {
+    free(pqueue->weights);
+    free(pqueue->nodes);
+    free(pqueue);
+    return 0;
+}
 
-    // Check if queue is full (our use case should never encounter
-    // this as we only reduce the queue length during the
-    // prefix-free encoding algorithm)
-    if (pqueue->length == pqueue->maxQueueLength) {
-        return 1;
-    }
+/*
+Helper for the priority queue methods.
+Returns true if the item with <weight> and tree node index <treeNode> leaves the queue before
+the item with <otherWeight> and <otherTreeNode>: it is lighter, or equally heavy with a lower
+tree node index.
+*/
+static inline int comesBefore(uint64_t weight, int treeNode, uint64_t otherWeight, int otherTreeNode) {
+    return weight < otherWeight || (weight == otherWeight && treeNode < otherTreeNode);
+}
 
-    // Add the item to the next empty slot
-    int i = 0;
-    while (i < pqueue->maxQueueLength) {
-        if (pqueue->queue[i].empty) {
+/*
+Helper for the priority queue methods.
+Move the item with <weight> and tree node <node> down the heap from position <i> until none of
+its children come before it, moving the first child up into the gap each time.
+*/
+static void siftDown(PriorityQueue *pqueue, int i, uint64_t weight, QueueNode node) {
+    uint64_t *weights = pqueue->weights;
+    QueueNode *nodes = pqueue->nodes;
+    int arity = pqueue->arity;
+    int length = pqueue->length;
+
+    while (1) {
+        int firstChild = arity * i + 1;
+        if (firstChild >= length) {
             break;
         }
-        i++;
+        int lastChild = firstChild + arity < length ? firstChild + arity : length;
+
+        // The children are adjacent so finding the first scans one run of weights
+        int minChild = firstChild;
+        for (int child = firstChild + 1; child < lastChild; child++) {
+            if (comesBefore(weights[child], nodes[child].treeNode,
+                            weights[minChild], nodes[minChild].treeNode)) {
+                minChild = child;
+            }
+        }
+        if (!comesBefore(weights[minChild], nodes[minChild].treeNode, weight, node.treeNode)) {
+            break;
+        }
+
+        weights[i] = weights[minChild];
+        nodes[i] = nodes[minChild];
+        i = minChild;
     }
 
-    if (i == pqueue->maxQueueLength) {
+    weights[i] = weight;
+    nodes[i] = node;
+}
+
+/*
+Replace the contents of the priority queue with the <numItems> items of <items>
+and order them into a heap in linear time
+
+Returns 0 if successful
+Returns 1 if the items do not fit in the queue
+*/
+int heapify(PriorityQueue *pqueue, QueueItem items[], int numItems) {
+    if (numItems > pqueue->maxQueueLength) {
         return 1;
     }
 
-    // Set this empty slot to the item
-    pqueue->queue[i] = item;
+    for (int i = 0; i < numItems; i++) {
+        pqueue->weights[i] = items[i].weight;
+        pqueue->nodes[i].symbol = items[i].symbol;
+        pqueue->nodes[i].treeNode = items[i].treeNode;
+    }
+    pqueue->length = numItems;
+
+    // Sift down every item with children, from the last one up to the root
+    for (int i = (numItems - 2) / pqueue->arity; numItems > 1 && i >= 0; i--) {
+        siftDown(pqueue, i, pqueue->weights[i], pqueue->nodes[i]);
+    }
+
+    return 0;
+}
+
+/*
+Enqueue method for the priority queue
 
-    // Move the new item up in the heap until the heap is satisfied.
+Returns 0 if successful
+Returns 1 if queue is full
+*/
+int enqueue(PriorityQueue *pqueue, QueueItem item) {
+    if (pqueue->length == pqueue->maxQueueLength) {
+        return 1;
+    }
+
+    // Start at the next free position at the end of the heap and move parents that come
+    // after the item down until the heap is satisfied.
+    // (Parent of child at index i is at index (i - 1) floor division by the arity)
+    int i = pqueue->length++;
     while (i > 0) {
-        // (Parent of child at index i is at index (i - 1) floor division by 2)
-        // C positive integer division is floor division
-        int parenti = (i - 1) / 2;
-        if (pqueue->queue[parenti].weight > item.weight) {
-            // Swap the parent and the child
-            pqueue->queue[i] = pqueue->queue[parenti];
-            pqueue->queue[parenti] = item;
-            i = parenti;
-        } else {
-            // Heap is now satisfied
+        int parenti = (i - 1) / pqueue->arity;
+        if (!comesBefore(item.weight, item.treeNode,
+                         pqueue->weights[parenti], pqueue->nodes[parenti].treeNode)) {
             break;
         }
+        pqueue->weights[i] = pqueue->weights[parenti];
+        pqueue->nodes[i] = pqueue->nodes[parenti];
+        i = parenti;
     }
 
-    pqueue->length++;
+    pqueue->weights[i] = item.weight;
+    pqueue->nodes[i].symbol = item.symbol;
+    pqueue->nodes[i].treeNode = item.treeNode;
 
     return 0;
 }
@@ -121,7 +220,8 @@ int enqueue(PriorityQueue *pqueue, QueueItem item) {
 /*
 Dequeue method for the priority queue
 
-Remove and return the first item in the priority queue
+Remove and return the first item (the item with the lowest weight, and of those the one
+with the lowest tree node index) in the priority queue
 The priority queue must be non empty
 */
 QueueItem dequeue(PriorityQueue *pqueue) {
@@ -130,70 +230,16 @@ QueueItem dequeue(PriorityQueue *pqueue) {
         exit(1);
     }
 
-    QueueItem item = pqueue->queue[0];
-    pqueue->length--;
-
-    // Move items up the min-heap as necessary
-    int i = 0;
-    while (i < pqueue->maxQueueLength) {
-        int lchildi = 2 * i + 1;
-        int rchildi = 2 * i + 2;
-
-        // Conditions for if the left and right children are out of bounds (OOB) or empty
-        // The Empty variables are set to true if the child is out of bounds
-        int lchildOOB = lchildi >= pqueue->maxQueueLength;
-        int rchildOOB = rchildi >= pqueue->maxQueueLength;
-        int lchildEmpty = lchildOOB ? 1 : pqueue->queue[lchildi].empty;
-        int rchildEmpty = rchildOOB ? 1 : pqueue->queue[rchildi].empty;
-
-
-        if (lchildOOB
-            || (rchildOOB && lchildEmpty)
-            || (lchildOOB && rchildOOB)
-            || (lchildEmpty && rchildEmpty)) {
-            // Left child is out of bounds or
-            // Right child is out of bounds and left child is an empty structure or
-            // Both children are out of bounds or
-            // Both children are empty (this is a leaf node)
-            // so we have reached the bottom of the heap
-            return item;
-        }
-
-        if (rchildOOB) {
-            // Right child is out of bounds but left child isn't and is nonempty
-            // so we move the left child up
-            pqueue->queue[i] = pqueue->queue[lchildi];
-            pqueue->queue[lchildi].empty = 1;
-            i = lchildi;
-
-            // Since the right child is out of bounds, the left child cannot have children
-            return item;
-        }
+    QueueItem item;
+    item.weight = pqueue->weights[0];
+    item.symbol = pqueue->nodes[0].symbol;
+    item.treeNode = pqueue->nodes[0].treeNode;
 
-        // Both children are in bounds so if child A is an empty node, swap the parent with child B
-        if (rchildEmpty) {
-            pqueue->queue[i] = pqueue->queue[lchildi];
-            pqueue->queue[lchildi].empty = 1;
-            i = lchildi;
-        } else if (lchildEmpty) {
-            pqueue->queue[i] = pqueue->queue[rchildi];
-            pqueue->queue[rchildi].empty = 1;
-            i = rchildi;
-        } else {
-            // Both children are in bounds and nonempty
-            // so we need to check which one has the lower weight
-            if (pqueue->queue[lchildi].weight < pqueue->queue[rchildi].weight) {
-                pqueue->queue[i] = pqueue->queue[lchildi];
-                pqueue->queue[lchildi].empty = 1;
-                i = lchildi;
-            } else {
-                pqueue->queue[i] = pqueue->queue[rchildi];
-                pqueue->queue[rchildi].empty = 1;
-                i = rchildi;
-            }
-        }        
-        // Since both children were in bounds and nonempty, we may not be at the bottom of the heap
+    // Move the last item into the gap at the root and sift it down
+    pqueue->length--;
+    if (pqueue->length > 0) {
+        siftDown(pqueue, 0, pqueue->weights[pqueue->length], pqueue->nodes[pqueue->length]);
     }
 
     return item;
-}
\ No newline at end of file
+}
@@ -1,53 +1,144 @@
+#ifndef PRIORITY_QUEUE_H
+#define PRIORITY_QUEUE_H
+
+#include <stdint.h>
+#include "encoding.h"
+
 /*
-A Tree node for a binary tree
-If left and right are NULL pointers, this node is a leaf node
+A node of a binary Tree, stored in the Tree's node array
+<leaf> is 1 if this node is a leaf node holding the real symbol <symbol>
+<leaf> is 0 if this node is an internal node (its <symbol> is unused)
+<left> and <right> are the indices of the children in the node array (-1 for leaf nodes)
+*/
+typedef struct tree_node {
+    unsigned char symbol;
+    int leaf;
+    int left;
+    int right;
+} TreeNode;
+
+// The number of nodes of the largest tree: a tree with n leaves has 2n - 1 nodes
+#define MAX_TREE_NODES (2 * MAX_ALPHABET_LEN - 1)
+
+/*
+A binary tree whose nodes are stored contiguously in <nodes>.
+numNodes is the number of nodes added.
+Nodes are only added after their children so the last node added is the root.
+The node array holds the tree of any alphabet, so a Tree is built without allocating
+(typically on the stack).
 */
 typedef struct tree {
-    char symbol;
-    struct tree *left;
-    struct tree *right;
+    TreeNode nodes[MAX_TREE_NODES];
+    int numNodes;
 } Tree;
 
+// The number of children of every node of the priority queue heap by default.
+// A 4-ary heap is half as deep as a binary heap and the children of a node are adjacent
+// in memory, so sifting touches fewer cache lines.
+#define QUEUE_ARITY 4
+
 /*
-A QueueItem is an item in a priority queue
-Empty is 1 if this QueueItem should be considered empty or NULL in the queue structure
-Empty is 0 if this QueueItem contains data as part of the queue structure
-Every QueueItem corresponds to a node in a binary tree and so has a pointer to that tree node
+A QueueItem is an item in a priority queue, ordered by <weight> and then by <treeNode>
+Every QueueItem corresponds to a node in a binary tree and so has the index of that tree node
+Tree node indices are unique, so items of equal weight always leave the queue in the same order.
 */
 typedef struct queue_item {
-    char symbol;
-    float weight;
-    int empty;
-    Tree *treeNode;
+    unsigned char symbol;
+    uint64_t weight;
+    int treeNode;
 } QueueItem;
 
 /*
-The priority queue data structure.
+The tree node an item of the heap refers to: everything of a QueueItem but its weight.
+Its <treeNode> breaks ties between equal weights and is never changed by the heap.
+*/
+typedef struct queue_node {
+    unsigned char symbol;
+    int treeNode;
+} QueueNode;
+
+/*
+The priority queue of tree nodes the Huffman Coding algorithm merges (see generateEncoding()):
+a min-heap with <arity> children per node. It only holds QueueItems, which are ordered by their
+weight and tree node index, so it is not a general purpose priority queue: the arity is the only
+thing that varies, and the comparison (comesBefore() in priority_queue.c) is fixed.
+
+The items are densely packed in positions [0, length) of the heap, with the weight of the
+item at position i in weights[i] and its tree node in nodes[i]. Keeping the weights
+in their own array means sifting compares weights that are next to each other in memory.
+The children of the item at position i are at positions arity * i + 1 to arity * i + arity.
+
+The arrays are provided by the caller of initQueue(), so a queue of at most MAX_ALPHABET_LEN
+items is built on the stack without allocating, and newQueue() allocates them for other sizes.
 
 maxQueueLength is the maximum elements this queue can support
 length is the current number of elements in the queue.
 */
 typedef struct priority_queue {
-    QueueItem *queue;
+    uint64_t *weights;
+    QueueNode *nodes;
+    int arity;
     int maxQueueLength;
     int length;
 } PriorityQueue;
 
 /*
-Initializes and returns a pointer to a new Tree with <symbol> and no children.
+Initializes the Tree pointed to by <tree> to an empty tree
+*/
+void initTree(Tree *tree);
+
+/*
+Add a leaf node with <symbol> to <tree>.
+
+Returns the index of the new node.
+Returns -1 if <tree> is full.
 */
-Tree *newTree(char symbol);
+int addLeafNode(Tree *tree, unsigned char symbol);
 
 /*
-Initializes and returns a new nonempty QueueItem
-If <treeNode> is NULL, a new Tree struct will be created with <symbol>
+Add an internal node with the children at indices <left> and <right> to <tree>.
+
+Returns the index of the new node.
+Returns -1 if <tree> is full.
 */
-QueueItem newQueueItem(char symbol, float weight, Tree *treeNode);
+int addInternalNode(Tree *tree, int left, int right);
 
 /*
-Initializes and returns a pointer to a new priority queue
+Initializes and returns a new QueueItem for the tree node at index <treeNode>
 */
-PriorityQueue *newQueue(int maxQueueLength);
+QueueItem newQueueItem(unsigned char symbol, uint64_t weight, int treeNode);
+
+/*
+Initializes the priority queue pointed to by <pqueue> to an empty queue of at most
+<maxQueueLength> items stored in <weights> and <nodes>, which must each hold <maxQueueLength>
+entries, whose heap nodes have <arity> (at least 2) children
+*/
+void initQueue(PriorityQueue *pqueue, uint64_t *weights, QueueNode *nodes, int maxQueueLength,
+               int arity);
+
+/*
+Initializes and returns a pointer to a new empty priority queue of at most <maxQueueLength>
+items whose heap nodes have <arity> (at least 2) children
+*/
+PriorityQueue *newQueue(int maxQueueLength, int arity);
+
+/*
+Deconstruct the priority queue returned by newQueue() pointed to by <pqueue> and free memory
+associated with it
+
+Return 0 on success
+Return 1 otherwise
+*/
+int destroyQueue(PriorityQueue *pqueue);
+
+/*
+Replace the contents of the priority queue with the <numItems> items of <items>
+and order them into a heap in linear time
+
+Returns 0 if successful
+Returns 1 if the items do not fit in the queue
+*/
+int heapify(PriorityQueue *pqueue, QueueItem items[], int numItems);
 
 /*
 Enqueue method for the priority queue
@@ -60,7 +151,10 @@ int enqueue(PriorityQueue *pqueue, QueueItem item);
 /*
 Dequeue method for the priority queue
 
-Remove and return the first item in the priority queue
+Remove and return the first item (the item with the lowest weight, and of those the one
+with the lowest tree node index) in the priority queue
 The priority queue must be non empty
 */
-QueueItem dequeue(PriorityQueue *pqueue);
\ No newline at end of file
+QueueItem dequeue(PriorityQueue *pqueue);
+
+#endif
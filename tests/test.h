@@ -0,0 +1,148 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "../encoding.h"
+#include "../huffman_coding.h"
+
+/*
+A minimal assertion helper and the fixtures shared by the test programs.
+CHECK() reports every condition that does not hold with its file and line and counts it, so one
+run reports all of the failures of a test program. TEST_RESULT() is returned from main().
+*/
+
+// The number of failed checks of the test program
+static int testFailures = 0;
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            testFailures++;                                                                \
+        }                                                                                  \
+    } while (0)
+
+/*
+Print the outcome of the test program <name>.
+Returns 0 if every check held and 1 otherwise.
+*/
+static inline int test_result(const char *name) {
+    if (testFailures > 0) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, testFailures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+#define TEST_RESULT() test_result(__FILE__)
+
+// The directory of the sources, which holds the fixtures of the tests (set by the Makefile)
+#ifndef TEST_SOURCE_DIR
+#define TEST_SOURCE_DIR "."
+#endif
+
+/*
+Returns the next number of the xorshift64 generator with state <state>, which must not be 0.
+Every test seeds its own generator so its data is the same on every run.
+*/
+static inline uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/*
+Returns a random symbol below <alphabetLen> from the generator with state <state>, drawn from
+a random prefix of the alphabet so the first symbols are the most frequent.
+*/
+static inline unsigned char random_symbol(uint64_t *state, int alphabetLen) {
+    uint64_t r = next_random(state);
+    return (r >> 8) % (1 + (r & 0xFF) % alphabetLen);
+}
+
+/*
+Returns the frequencies of an alphabet of the first <n> byte values with the weights <weights>.
+*/
+static inline Frequencies frequencies_of(const uint64_t *weights, int n) {
+    Frequencies freqs;
+    snprintf(freqs.name, MAX_NAME, "test");
+    freqs.alphabetlen = n;
+    for (int i = 0; i < n; i++) {
+        freqs.alphabet[i] = i;
+        freqs.frequencies[i] = weights[i];
+    }
+    return freqs;
+}
+
+/*
+Returns the canonical Huffman encoding of the first <n> byte values with the weights <weights>
+(see generateCanonicalEncoding()).
+*/
+static inline Encoding *encoding_of(const uint64_t *weights, int n) {
+    Frequencies freqs = frequencies_of(weights, n);
+    return generateCanonicalEncoding(freqs, freqs.name);
+}
+
+/*
+Returns the <numBytes> little-endian bytes at <bytes> as an integer.
+*/
+static inline uint64_t get_le(const unsigned char *bytes, int numBytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < numBytes; i++) {
+        value |= (uint64_t) bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+/*
+Store <value> as <numBytes> little-endian bytes at <bytes>.
+*/
+static inline void put_le(unsigned char *bytes, uint64_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+        bytes[i] = value >> (8 * i);
+    }
+}
+
+/*
+Write the <len> bytes at <data> to a new file at <path>.
+*/
+static inline void write_file(const char *path, const unsigned char *data, size_t len) {
+    FILE *file = fopen(path, "w");
+    CHECK(file != NULL);
+    if (file != NULL) {
+        CHECK(fwrite(data, 1, len, file) == len);
+        fclose(file);
+    }
+}
+
+/*
+Returns true if the file at <path> holds exactly the <len> bytes at <data>.
+*/
+static inline bool file_equals(const char *path, const unsigned char *data, size_t len) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    unsigned char *contents = malloc(len + 1);
+    size_t readLen = fread(contents, 1, len + 1, file);
+    bool equal = readLen == len && memcmp(contents, data, len) == 0;
+    free(contents);
+    fclose(file);
+    return equal;
+}
+
+/*
+Returns true if there is a file at <path>.
+*/
+static inline bool file_exists(const char *path) {
+    return access(path, F_OK) == 0;
+}
+
+#endif
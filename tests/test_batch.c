@@ -0,0 +1,203 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "test.h"
+#include "../batch.h"
+#include "../codec.h"
+#include "../huffman_coding.h"
+
+// The number of files of the batch and the size of each of them
+#define TEST_FILES 5
+#define TEST_FILE_SIZE 300000
+// The file of the batch holding a symbol outside of the encoding alphabet, near its end so
+// part of its output is written before it fails
+#define TEST_BAD_FILE 1
+#define TEST_BAD_POS (TEST_FILE_SIZE - 1000)
+
+/*
+Run code_batch() with its errors to standard error discarded, so the failures the tests cause
+are not mistaken for failed checks.
+*/
+static int quiet_code_batch(char **inputPaths, char **outputPaths, int numFiles, bool compressing,
+                            Encoding *encoding, int numStreams, int numThreads, BatchStats *stats) {
+    fflush(stderr);
+    int savedStderr = dup(STDERR_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDERR_FILENO);
+    close(devNull);
+
+    int ret = code_batch(inputPaths, outputPaths, numFiles, compressing, encoding, false, 0,
+                         numStreams, numThreads, stats);
+
+    fflush(stderr);
+    dup2(savedStderr, STDERR_FILENO);
+    close(savedStderr);
+    return ret;
+}
+
+/*
+A batch with a file holding a symbol outside of the encoding alphabet and a file that does not
+exist codes every other file, removes the outputs of the failed files and returns the error of
+the first failed file of the list. The compressed files then decompress as a batch to the
+original files, and a file that cannot be decompressed fails and has its output removed.
+*/
+static void test_failing_files(const char *dir, int numStreams, int numThreads) {
+    char paths[2 * (TEST_FILES + 1)][256];
+    char *inputPaths[TEST_FILES + 1];
+    char *outputPaths[TEST_FILES + 1];
+    for (int i = 0; i <= TEST_FILES; i++) {
+        snprintf(paths[2 * i], sizeof(paths[0]), "%s/file%d", dir, i);
+        snprintf(paths[2 * i + 1], sizeof(paths[0]), "%s/file%d.cmp", dir, i);
+        inputPaths[i] = paths[2 * i];
+        outputPaths[i] = paths[2 * i + 1];
+    }
+
+    // The files are bytes 'a' to 'p' except for the bad file's symbol, and file TEST_FILES is
+    // never written
+    unsigned char *data[TEST_FILES];
+    uint64_t state = 0x3F84D5B5B5470917ULL;
+    for (int i = 0; i < TEST_FILES; i++) {
+        data[i] = malloc(TEST_FILE_SIZE);
+        for (size_t j = 0; j < TEST_FILE_SIZE; j++) {
+            data[i][j] = 'a' + random_symbol(&state, 16);
+        }
+        if (i == TEST_BAD_FILE) {
+            data[i][TEST_BAD_POS] = 'z';
+        }
+        write_file(inputPaths[i], data[i], TEST_FILE_SIZE);
+    }
+
+    Frequencies freqs;
+    snprintf(freqs.name, MAX_NAME, "test");
+    freqs.alphabetlen = 16;
+    for (int i = 0; i < 16; i++) {
+        freqs.alphabet[i] = 'a' + i;
+        freqs.frequencies[i] = 16 - i;
+    }
+    Encoding *encoding = generateCanonicalEncoding(freqs, freqs.name);
+
+    // The missing file is the last of the list
+    BatchStats stats = newBatchStats();
+    int ret = quiet_code_batch(inputPaths, outputPaths, TEST_FILES + 1, true, encoding, numStreams,
+                               numThreads, &stats);
+    CHECK(ret == 1);
+    CHECK(stats.numFiles == TEST_FILES + 1);
+    CHECK(stats.numFailed == 2);
+    CHECK(stats.inputBytes == (TEST_FILES - 1) * TEST_FILE_SIZE);
+    CHECK(!file_exists(outputPaths[TEST_BAD_FILE]));
+    CHECK(!file_exists(outputPaths[TEST_FILES]));
+
+    // With the missing file first its error is returned
+    char *missingFirstInputs[] = {inputPaths[TEST_FILES], inputPaths[TEST_BAD_FILE]};
+    char *missingFirstOutputs[] = {outputPaths[TEST_FILES], outputPaths[TEST_BAD_FILE]};
+    stats = newBatchStats();
+    ret = quiet_code_batch(missingFirstInputs, missingFirstOutputs, 2, true, encoding, numStreams,
+                           numThreads, &stats);
+    CHECK(ret == 3);
+    CHECK(stats.numFailed == 2);
+
+    // Decompress the compressed files as a batch, with a file that is not a container (and so
+    // is taken for a legacy file without its encoding) in place of the bad file's output
+    char decodedPaths[TEST_FILES][256];
+    char *decodedPathPtrs[TEST_FILES];
+    for (int i = 0; i < TEST_FILES; i++) {
+        snprintf(decodedPaths[i], sizeof(decodedPaths[0]), "%s.out", outputPaths[i]);
+        decodedPathPtrs[i] = decodedPaths[i];
+    }
+    write_file(outputPaths[TEST_BAD_FILE], data[0], 1000);
+
+    stats = newBatchStats();
+    ret = quiet_code_batch(outputPaths, decodedPathPtrs, TEST_FILES, false, NULL, numStreams,
+                           numThreads, &stats);
+    CHECK(ret == 4);
+    CHECK(stats.numFailed == 1);
+    CHECK(stats.outputBytes == (TEST_FILES - 1) * TEST_FILE_SIZE);
+    for (int i = 0; i < TEST_FILES; i++) {
+        if (i == TEST_BAD_FILE) {
+            CHECK(!file_exists(decodedPaths[i]));
+        } else {
+            CHECK(file_equals(decodedPaths[i], data[i], TEST_FILE_SIZE));
+        }
+        remove(decodedPaths[i]);
+    }
+
+    for (int i = 0; i <= TEST_FILES; i++) {
+        remove(paths[2 * i]);
+        remove(paths[2 * i + 1]);
+    }
+    for (int i = 0; i < TEST_FILES; i++) {
+        free(data[i]);
+    }
+    destroyEncoding(encoding);
+}
+
+/*
+Two files of the same name in different directories get the same output path in one output
+directory. The first file of the list is coded into it and the second fails without being coded,
+so it cannot overwrite the first file's output, whatever order the workers take them in.
+*/
+static void test_duplicate_outputs(const char *dir) {
+    char dirs[3][128];
+    char paths[3][256];
+    static const char *names[] = {"d1", "d2", "out"};
+    for (int i = 0; i < 3; i++) {
+        snprintf(dirs[i], sizeof(dirs[0]), "%s/%s", dir, names[i]);
+        CHECK(mkdir(dirs[i], 0700) == 0);
+    }
+    snprintf(paths[0], sizeof(paths[0]), "%s/x", dirs[0]);
+    snprintf(paths[1], sizeof(paths[0]), "%s/x", dirs[1]);
+    snprintf(paths[2], sizeof(paths[0]), "%s/x.cmp", dirs[2]);
+    char *inputPaths[] = {paths[0], paths[1]};
+    char *outputPaths[] = {paths[2], paths[2]};
+
+    unsigned char first[TEST_FILE_SIZE];
+    unsigned char second[TEST_FILE_SIZE / 2];
+    memset(first, 'a', sizeof(first));
+    memset(second, 'b', sizeof(second));
+    write_file(paths[0], first, sizeof(first));
+    write_file(paths[1], second, sizeof(second));
+
+    Frequencies freqs;
+    snprintf(freqs.name, MAX_NAME, "test");
+    freqs.alphabetlen = 2;
+    freqs.alphabet[0] = 'a';
+    freqs.alphabet[1] = 'b';
+    freqs.frequencies[0] = freqs.frequencies[1] = 1;
+    Encoding *encoding = generateCanonicalEncoding(freqs, freqs.name);
+
+    BatchStats stats = newBatchStats();
+    int ret = quiet_code_batch(inputPaths, outputPaths, 2, true, encoding, 1, 2, &stats);
+    CHECK(ret == 2);
+    CHECK(stats.numFiles == 2);
+    CHECK(stats.numFailed == 1);
+    CHECK(stats.inputBytes == sizeof(first));
+
+    // The output holds the first file
+    char decodedPath[256];
+    snprintf(decodedPath, sizeof(decodedPath), "%s/x.out", dirs[2]);
+    char *decodeInputs[] = {paths[2]};
+    char *decodeOutputs[] = {decodedPath};
+    stats = newBatchStats();
+    CHECK(quiet_code_batch(decodeInputs, decodeOutputs, 1, false, NULL, 1, 1, &stats) == 0);
+    CHECK(file_equals(decodedPath, first, sizeof(first)));
+
+    remove(decodedPath);
+    for (int i = 0; i < 3; i++) {
+        remove(paths[i]);
+        rmdir(dirs[i]);
+    }
+    destroyEncoding(encoding);
+}
+
+int main() {
+    char dir[] = "/tmp/test_batch_XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    test_failing_files(dir, 1, 1);
+    test_failing_files(dir, CODEC_STREAMS, 3);
+    test_duplicate_outputs(dir);
+    CHECK(rmdir(dir) == 0);
+    return TEST_RESULT();
+}
@@ -0,0 +1,220 @@
+#include <stdint.h>
+#include <string.h>
+#include "test.h"
+#include "../bitstream.h"
+
+// The size of the output buffers of the tests, which leaves room for BIT_WRITER_SLACK
+#define TEST_BUFFER_SIZE 1024
+
+/*
+Returns bit <i> of the LSB-first stream in <bytes>, read one bit at a time as the reference.
+*/
+static int stream_bit(const unsigned char *bytes, size_t i) {
+    return (bytes[i / 8] >> (i % 8)) & 1;
+}
+
+/*
+Codes that straddle the 64-bit words of the bit buffer are written and read back intact.
+60 bits are put before a 12 bit code, so the code crosses bit 64 of the stream, and then codes
+of random lengths from 1 to 32 bits are put, flushing after every code.
+*/
+static void test_word_boundary() {
+    unsigned char output[TEST_BUFFER_SIZE];
+    uint32_t codes[200];
+    int lengths[200];
+    int numCodes = 0;
+    uint64_t state = 0x243F6A8885A308D3ULL;
+
+    codes[numCodes] = 0x0ABCDEF;
+    lengths[numCodes++] = 28;
+    codes[numCodes] = 0xFFFFFFFF;
+    lengths[numCodes++] = 32;
+    codes[numCodes] = 0xA5B;
+    lengths[numCodes++] = 12;
+    while (numCodes < 200) {
+        lengths[numCodes] = 1 + next_random(&state) % 32;
+        codes[numCodes] = next_random(&state) & ((1ULL << lengths[numCodes]) - 1);
+        numCodes++;
+    }
+
+    memset(output, 0xFF, sizeof(output));
+    BitWriter writer = newBitWriter(output);
+    size_t totalBits = 0;
+    for (int i = 0; i < numCodes; i++) {
+        put_bits(&writer, codes[i], lengths[i]);
+        flush_bits(&writer);
+        totalBits += lengths[i];
+    }
+    size_t len = finish_bits(&writer);
+    CHECK(len == (totalBits + 7) / 8);
+
+    // Every code is in the stream at its position, first bit lowest
+    size_t pos = 0;
+    for (int i = 0; i < numCodes; i++) {
+        uint32_t code = 0;
+        for (int j = 0; j < lengths[i]; j++) {
+            code |= (uint32_t) stream_bit(output, pos++) << j;
+        }
+        CHECK(code == codes[i]);
+    }
+
+    // The codes read back, the first refill loading whole words and the last ones single bytes
+    BitReader reader = newBitReader(output, len);
+    for (int i = 0; i < numCodes; i++) {
+        if (reader.bitCount < lengths[i]) {
+            refill_bits(&reader);
+        }
+        CHECK(reader.bitCount >= lengths[i]);
+        CHECK(peek_bits(&reader, lengths[i]) == codes[i]);
+        consume_bits(&reader, lengths[i]);
+    }
+    CHECK(reader.inputPos == len);
+    CHECK(reader.bitCount == (int) (8 * len - totalBits));
+}
+
+/*
+Putting 56 bits after 7 unflushed bits, the most allowed between flushes, fills the whole
+bit buffer, and all 63 bits are written and read back.
+*/
+static void test_full_put() {
+    unsigned char output[TEST_BUFFER_SIZE];
+    BitWriter writer = newBitWriter(output);
+    put_bits(&writer, 0x7F, 7);
+    flush_bits(&writer);
+    put_bits(&writer, 0x12345678, 32);
+    put_bits(&writer, 0xABCDEF, 24);
+    flush_bits(&writer);
+    CHECK(writer.bitCount == 7);
+    CHECK(finish_bits(&writer) == 8);
+
+    // A word refill keeps the 7 whole bytes that fit and the next refill reads the last one
+    BitReader reader = newBitReader(output, 8);
+    refill_bits(&reader);
+    CHECK(reader.bitCount == 56);
+    CHECK(reader.inputPos == 7);
+    CHECK(peek_bits(&reader, 7) == 0x7F);
+    consume_bits(&reader, 7);
+    CHECK(peek_bits(&reader, 32) == 0x12345678);
+    consume_bits(&reader, 32);
+    refill_bits(&reader);
+    CHECK(reader.bitCount == 25);
+    CHECK(peek_bits(&reader, 24) == 0xABCDEF);
+}
+
+/*
+The last partial byte is written by finish_bits() with the bits past the end of the stream
+set to zero, whatever the output held before.
+*/
+static void test_partial_byte() {
+    unsigned char output[TEST_BUFFER_SIZE];
+    memset(output, 0xFF, sizeof(output));
+    BitWriter writer = newBitWriter(output);
+    put_bits(&writer, 0x5, 3);
+    flush_bits(&writer);
+    CHECK(writer.outputPos == 0);
+    CHECK(finish_bits(&writer) == 1);
+    CHECK(output[0] == 0x05);
+    CHECK(writer.bitCount == 0 && writer.bitBuffer == 0);
+
+    memset(output, 0xFF, sizeof(output));
+    writer = newBitWriter(output);
+    put_bits(&writer, 0x1ABC, 13);
+    flush_bits(&writer);
+    CHECK(writer.outputPos == 1);
+    CHECK(finish_bits(&writer) == 2);
+    CHECK(output[0] == 0xBC);
+    CHECK(output[1] == 0x1A);
+
+    // Without a flush the bits are written by finish_bits() alone
+    memset(output, 0xFF, sizeof(output));
+    writer = newBitWriter(output);
+    put_bits(&writer, 0x3FFFF, 18);
+    CHECK(finish_bits(&writer) == 3);
+    CHECK(output[0] == 0xFF && output[1] == 0xFF && output[2] == 0x03);
+
+    // A stream of whole bytes gets no padding byte
+    writer = newBitWriter(output);
+    put_bits(&writer, 0xA55A, 16);
+    flush_bits(&writer);
+    CHECK(finish_bits(&writer) == 2);
+    CHECK(output[0] == 0x5A && output[1] == 0xA5);
+}
+
+/*
+Refilling near the end of the input reads the bytes that are left one at a time, and refilling
+at the end of the input leaves the bit buffer as it is.
+*/
+static void test_refill_at_end() {
+    unsigned char input[11];
+    for (int i = 0; i < 11; i++) {
+        input[i] = 0x11 * (i + 1);
+    }
+
+    // Fewer than 8 bytes: every byte is read one at a time
+    BitReader reader = newBitReader(input, 5);
+    refill_bits(&reader);
+    CHECK(reader.inputPos == 5);
+    CHECK(reader.bitCount == 40);
+    CHECK(peek_bits(&reader, 40) == 0x5544332211ULL);
+    consume_bits(&reader, 36);
+    refill_bits(&reader);
+    CHECK(reader.bitCount == 4);
+    CHECK(peek_bits(&reader, 4) == 0x5);
+    consume_bits(&reader, 4);
+    refill_bits(&reader);
+    CHECK(reader.bitCount == 0);
+    CHECK(peek_bits(&reader, 16) == 0);
+
+    // 11 bytes: a whole word first, then the rest a byte at a time, ending on the last bit
+    reader = newBitReader(input, 11);
+    size_t pos = 0;
+    while (pos < 8 * 11) {
+        refill_bits(&reader);
+        int numBits = reader.bitCount < 13 ? reader.bitCount : 13;
+        CHECK(numBits > 0);
+        if (numBits <= 0) {
+            break;
+        }
+        uint64_t bits = peek_bits(&reader, numBits);
+        for (int j = 0; j < numBits; j++) {
+            CHECK((int) ((bits >> j) & 1) == stream_bit(input, pos + j));
+        }
+        consume_bits(&reader, numBits);
+        pos += numBits;
+    }
+    CHECK(pos == 8 * 11);
+    CHECK(reader.inputPos == 11);
+    refill_bits(&reader);
+    CHECK(reader.bitCount == 0);
+}
+
+/*
+An empty stream is written as no bytes at all, and reading one gives no bits.
+*/
+static void test_empty_stream() {
+    unsigned char output[TEST_BUFFER_SIZE];
+    memset(output, 0xFF, sizeof(output));
+    BitWriter writer = newBitWriter(output);
+    CHECK(finish_bits(&writer) == 0);
+    CHECK(output[0] == 0xFF);
+
+    // Flushing nothing only overwrites the slack past the end
+    flush_bits(&writer);
+    CHECK(writer.outputPos == 0);
+    CHECK(finish_bits(&writer) == 0);
+
+    BitReader reader = newBitReader(output, 0);
+    refill_bits(&reader);
+    CHECK(reader.inputPos == 0);
+    CHECK(reader.bitCount == 0);
+    CHECK(peek_bits(&reader, 8) == 0);
+}
+
+int main() {
+    test_word_boundary();
+    test_full_put();
+    test_partial_byte();
+    test_refill_at_end();
+    test_empty_stream();
+    return TEST_RESULT();
+}
@@ -0,0 +1,313 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "../codec.h"
+#include "../compressor.h"
+#include "../container.h"
+
+// The size of the uncompressed data: three whole blocks and half of a fourth
+#define TEST_DATA_SIZE (3 * CMP_BLOCK_SIZE + CMP_BLOCK_SIZE / 2)
+#define TEST_ALPHABET_LEN 64
+
+/*
+Returns the contents of <file> from its start in a new buffer and their size in <len>.
+*/
+static unsigned char *file_contents(FILE *file, size_t *len) {
+    fflush(file);
+    fseek(file, 0, SEEK_END);
+    *len = ftell(file);
+    unsigned char *contents = malloc(*len + 1);
+    rewind(file);
+    CHECK(fread(contents, 1, *len, file) == *len);
+    return contents;
+}
+
+/*
+Returns a new temporary file holding the <len> bytes at <data>, positioned at its start.
+*/
+static FILE *file_of(const unsigned char *data, size_t len) {
+    FILE *file = tmpfile();
+    CHECK(file != NULL);
+    CHECK(fwrite(data, 1, len, file) == len);
+    rewind(file);
+    return file;
+}
+
+/*
+Compress the <len> bytes at <data> with <encoding> and returns the container in a new buffer
+and its size in <containerLen>.
+*/
+static unsigned char *compress(const unsigned char *data, size_t len, Encoding *encoding,
+                               bool adaptive, int numStreams, size_t *containerLen) {
+    FILE *input = file_of(data, len);
+    FILE *output = tmpfile();
+    CHECK(encode_file(input, output, encoding, adaptive, 0, numStreams, 2, NULL) == 0);
+    unsigned char *container = file_contents(output, containerLen);
+    fclose(input);
+    fclose(output);
+    return container;
+}
+
+/*
+Decode the <rangeLength> bytes from <rangeStart> of the container <input> with <numThreads>
+threads and check that they are the bytes of <data> of <len> bytes in the same range.
+*/
+static void check_range_of(FILE *input, const unsigned char *data, size_t len,
+                           uint64_t rangeStart, uint64_t rangeLength, int numThreads) {
+    uint64_t expectedStart = rangeStart < len ? rangeStart : len;
+    uint64_t expectedLen = len - expectedStart < rangeLength ? len - expectedStart : rangeLength;
+
+    FILE *output = tmpfile();
+    CHECK(decode_range(input, output, rangeStart, rangeLength, numThreads, NULL) == 0);
+    size_t outputLen;
+    unsigned char *decoded = file_contents(output, &outputLen);
+    CHECK(outputLen == expectedLen);
+    CHECK(outputLen == expectedLen && memcmp(decoded, data + expectedStart, outputLen) == 0);
+    free(decoded);
+    fclose(output);
+}
+
+/*
+Check the range of check_range_of() of the container <container> of <containerLen> bytes, read
+from a file with the block index and, on one thread, from a pipe out of the copy of the
+container at <path>, which is read front to back.
+*/
+static void check_range(const unsigned char *container, size_t containerLen, const char *path,
+                        const unsigned char *data, size_t len, uint64_t rangeStart,
+                        uint64_t rangeLength, int numThreads) {
+    FILE *input = file_of(container, containerLen);
+    check_range_of(input, data, len, rangeStart, rangeLength, numThreads);
+    fclose(input);
+
+    if (numThreads == 1) {
+        char command[64];
+        snprintf(command, sizeof(command), "cat %s", path);
+        FILE *pipe = popen(command, "r");
+        CHECK(pipe != NULL);
+        if (pipe != NULL) {
+            check_range_of(pipe, data, len, rangeStart, rangeLength, numThreads);
+            // The rest of the container after the range is left unread
+            while (fgetc(pipe) != EOF) {
+            }
+            pclose(pipe);
+        }
+    }
+}
+
+/*
+Ranges of a container of several blocks decode to the same bytes of the uncompressed data,
+whether they start at the start of a block or within one, end within the same block or cross
+block boundaries, or run past the end of the data, and whether the container is read with its
+block index or through a pipe.
+*/
+static void test_ranges(const unsigned char *data, Encoding *encoding, bool adaptive,
+                        int numStreams) {
+    size_t containerLen;
+    unsigned char *container = compress(data, TEST_DATA_SIZE, encoding, adaptive, numStreams,
+                                        &containerLen);
+    uint64_t blockSize = adaptive ? CMP_ADAPTIVE_BLOCK_SIZE : CMP_BLOCK_SIZE;
+    const uint64_t ranges[][2] = {
+        {0, UINT64_MAX},
+        {0, 1},
+        {12345, 1000},
+        {blockSize - 1, 2},
+        {blockSize, 1},
+        {blockSize / 2, 2 * blockSize},
+        {blockSize + 7, blockSize - 7},
+        {3 * blockSize - 100, TEST_DATA_SIZE},
+        {TEST_DATA_SIZE - 1, 1},
+        {TEST_DATA_SIZE - 1, UINT64_MAX},
+        {TEST_DATA_SIZE, 10},
+        {TEST_DATA_SIZE + 1000, UINT64_MAX},
+        {blockSize / 3, 0},
+    };
+    char path[] = "/tmp/test_container_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+    write_file(path, container, containerLen);
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        for (int numThreads = 1; numThreads <= 3; numThreads += 2) {
+            check_range(container, containerLen, path, data, TEST_DATA_SIZE, ranges[i][0],
+                        ranges[i][1], numThreads);
+        }
+    }
+    remove(path);
+    free(container);
+}
+
+/*
+findBlock() returns the block holding a raw offset, including the first and last byte of
+every block, and the number of blocks for offsets past the end of the data.
+*/
+static void test_find_block() {
+    BlockIndex *index = newBlockIndex();
+    CHECK(findBlock(index, 0) == 0);
+    CHECK(findBlock(index, 100) == 0);
+
+    addBlock(index, 20, 10, 0, 100, 11);
+    CHECK(findBlock(index, 0) == 0);
+    CHECK(findBlock(index, 99) == 0);
+    CHECK(findBlock(index, 100) == 1);
+
+    // Blocks of different sizes, as in the index of a container with a shorter last block
+    const uint32_t rawSizes[] = {100, 1, 50, 1000, 7};
+    uint64_t rawOffset = 100;
+    for (int i = 1; i < 5; i++) {
+        addBlock(index, 20 + 10 * i, 10, rawOffset, rawSizes[i], 11);
+        rawOffset += rawSizes[i];
+    }
+    rawOffset = 0;
+    for (int i = 0; i < 5; i++) {
+        CHECK(findBlock(index, rawOffset) == i);
+        CHECK(findBlock(index, rawOffset + rawSizes[i] - 1) == i);
+        rawOffset += rawSizes[i];
+    }
+    CHECK(findBlock(index, rawOffset) == 5);
+    CHECK(findBlock(index, rawOffset + 1) == 5);
+    CHECK(findBlock(index, UINT64_MAX) == 5);
+    destroyBlockIndex(index);
+}
+
+/*
+The block index read from a container describes every block in order.
+*/
+static void test_read_index(const unsigned char *data, Encoding *encoding) {
+    size_t containerLen;
+    unsigned char *container = compress(data, TEST_DATA_SIZE, encoding, false, 1, &containerLen);
+    FILE *file = file_of(container, containerLen);
+    BlockIndex *index = readBlockIndex(file);
+    CHECK(index != NULL);
+    if (index != NULL) {
+        CHECK(index->numBlocks == 4);
+        for (int i = 0; i < index->numBlocks; i++) {
+            CHECK(index->blocks[i].rawOffset == (uint64_t) i * CMP_BLOCK_SIZE);
+            CHECK(index->blocks[i].rawSize == (i < 3 ? CMP_BLOCK_SIZE : CMP_BLOCK_SIZE / 2));
+            CHECK(index->blocks[i].tableOffset == CMP_ENCODING_OFFSET);
+            CHECK(findBlock(index, index->blocks[i].rawOffset) == i);
+        }
+        CHECK(findBlock(index, TEST_DATA_SIZE - 1) == 3);
+        CHECK(findBlock(index, TEST_DATA_SIZE) == 4);
+        destroyBlockIndex(index);
+    }
+    fclose(file);
+    free(container);
+}
+
+/*
+Check that the container <container> of <len> bytes is rejected: its block index is not read
+and decoding any range of it fails with 3.
+*/
+static void check_rejected(const unsigned char *container, size_t len) {
+    FILE *file = file_of(container, len);
+    BlockIndex *index = readBlockIndex(file);
+    CHECK(index == NULL);
+    if (index != NULL) {
+        destroyBlockIndex(index);
+    }
+    FILE *output = tmpfile();
+    CHECK(decode_range(file, output, 0, UINT64_MAX, 1, NULL) == 3);
+    CHECK(decode_range(file, output, CMP_BLOCK_SIZE + 1, 10, 2, NULL) == 3);
+    fclose(output);
+    fclose(file);
+}
+
+/*
+A container with a corrupt trailer, block index entry or block offsets is rejected instead of
+read.
+*/
+static void test_corrupt(const unsigned char *data, Encoding *encoding) {
+    size_t len;
+    unsigned char *container = compress(data, TEST_DATA_SIZE, encoding, false, 1, &len);
+    unsigned char *corrupt = malloc(len);
+    unsigned char *trailer = corrupt + len - CMP_TRAILER_SIZE;
+    uint64_t indexOffset = get_le(&container[len - CMP_TRAILER_SIZE], 8);
+    unsigned char *lastEntry = trailer - CMP_INDEX_ENTRY_SIZE;
+    unsigned char *secondEntry = corrupt + indexOffset + CMP_INDEX_ENTRY_SIZE;
+
+    // The trailer magic
+    memcpy(corrupt, container, len);
+    trailer[15] ^= 1;
+    check_rejected(corrupt, len);
+
+    // The offset of the block index, which no longer ends at the trailer
+    memcpy(corrupt, container, len);
+    put_le(&trailer[0], indexOffset + 1, 8);
+    check_rejected(corrupt, len);
+    put_le(&trailer[0], UINT64_MAX - 10, 8);
+    check_rejected(corrupt, len);
+
+    // The number of blocks
+    memcpy(corrupt, container, len);
+    put_le(&trailer[8], 3, 4);
+    check_rejected(corrupt, len);
+    put_le(&trailer[8], UINT32_MAX, 4);
+    check_rejected(corrupt, len);
+
+    // A raw offset that leaves a gap between blocks, or makes them overlap
+    memcpy(corrupt, container, len);
+    put_le(&secondEntry[12], CMP_BLOCK_SIZE + 1, 8);
+    check_rejected(corrupt, len);
+    put_le(&secondEntry[12], CMP_BLOCK_SIZE - 1, 8);
+    check_rejected(corrupt, len);
+
+    // A block whose bits run into the block index
+    memcpy(corrupt, container, len);
+    put_le(&lastEntry[8], get_le(&lastEntry[8], 4) + CMP_BLOCK_HEADER_SIZE + 1, 4);
+    check_rejected(corrupt, len);
+    memcpy(corrupt, container, len);
+    put_le(&lastEntry[0], indexOffset, 8);
+    check_rejected(corrupt, len);
+    put_le(&lastEntry[0], UINT64_MAX - 1, 8);
+    check_rejected(corrupt, len);
+
+    // A table offset inside the container header or after the block
+    memcpy(corrupt, container, len);
+    put_le(&secondEntry[24], CMP_ENCODING_OFFSET - 1, 8);
+    check_rejected(corrupt, len);
+    put_le(&secondEntry[24], get_le(&secondEntry[0], 8), 8);
+    check_rejected(corrupt, len);
+
+    // The file cut short, so the trailer is missing or not where the index says
+    check_rejected(container, len - 1);
+    check_rejected(container, len - CMP_TRAILER_SIZE);
+    check_rejected(container, CMP_TRAILER_SIZE - 1);
+
+    // A block larger than the container's block size passes the index checks but is not read
+    memcpy(corrupt, container, len);
+    put_le(&lastEntry[20], CMP_BLOCK_SIZE + 1, 4);
+    FILE *file = file_of(corrupt, len);
+    FILE *output = tmpfile();
+    CHECK(decode_range(file, output, 0, UINT64_MAX, 1, NULL) == 3);
+    fclose(output);
+    fclose(file);
+
+    free(corrupt);
+    free(container);
+}
+
+int main() {
+    uint64_t weights[TEST_ALPHABET_LEN];
+    for (int i = 0; i < TEST_ALPHABET_LEN; i++) {
+        weights[i] = TEST_ALPHABET_LEN - i;
+    }
+    Encoding *encoding = encoding_of(weights, TEST_ALPHABET_LEN);
+
+    uint64_t state = 0x5EED;
+    unsigned char *data = malloc(TEST_DATA_SIZE);
+    for (size_t i = 0; i < TEST_DATA_SIZE; i++) {
+        data[i] = random_symbol(&state, TEST_ALPHABET_LEN);
+    }
+
+    test_find_block();
+    test_read_index(data, encoding);
+    test_ranges(data, encoding, false, 1);
+    test_ranges(data, encoding, false, CODEC_STREAMS);
+    test_ranges(data, encoding, true, CODEC_STREAMS);
+    test_corrupt(data, encoding);
+
+    free(data);
+    destroyEncoding(encoding);
+    return TEST_RESULT();
+}
@@ -0,0 +1,213 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "../compressor.h"
+#include "../encoding.h"
+
+// The sample encoding and text of the README, in the version 1 (legacy) formats
+#define TEST_SAMPLE_DIR TEST_SOURCE_DIR "/sample_encodings/a_to_f"
+
+/*
+Returns true if <encoding> and <other> have the same name, alphabet, lengths and codes.
+*/
+static bool encodings_equal(const Encoding *encoding, const Encoding *other) {
+    if (strcmp(encoding->name, other->name) != 0 || encoding->alphabetlen != other->alphabetlen) {
+        return false;
+    }
+    for (int i = 0; i < encoding->alphabetlen; i++) {
+        if (encoding->alphabet[i] != other->alphabet[i] || encoding->lengths[i] != other->lengths[i]
+            || encoding->codes[i] != other->codes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+Returns the number of bytes of the file at <path> read into <data>, which holds <capacity> bytes.
+*/
+static size_t read_file(const char *path, unsigned char *data, size_t capacity) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return 0;
+    }
+    size_t len = fread(data, 1, capacity, file);
+    fclose(file);
+    return len;
+}
+
+/*
+Canonical encodings of a full byte alphabet (including '\0') and of a single symbol are saved in
+version ENC_FORMAT_VERSION of the format and load back unchanged. The file is the header, the
+format marker and version and the compact encoding, with its (symbol, length) pairs in
+alphabet order.
+*/
+static void test_round_trip(const char *dir) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/full.enc", dir);
+
+    uint64_t weights[MAX_ALPHABET_LEN];
+    for (int i = 0; i < MAX_ALPHABET_LEN; i++) {
+        weights[i] = 1 + (uint64_t) (MAX_ALPHABET_LEN - i) * (MAX_ALPHABET_LEN - i);
+    }
+    Encoding *full = encoding_of(weights, MAX_ALPHABET_LEN);
+    strcpy(full->name, "a name of 31 characters long..");
+    CHECK(save(path, full) == 0);
+
+    unsigned char data[1024];
+    size_t len = read_file(path, data, sizeof(data));
+    CHECK(len == (size_t) (HEADER_SIZE + 2 + compactEncodingSize(full)));
+    CHECK(memcmp(data, HEADER, HEADER_SIZE) == 0);
+    CHECK(data[HEADER_SIZE] == ENC_FORMAT_MARKER && data[HEADER_SIZE + 1] == ENC_FORMAT_VERSION);
+    CHECK(data[HEADER_SIZE + 2] == strlen(full->name));
+    size_t pairs = HEADER_SIZE + 3 + strlen(full->name) + 2;
+    CHECK(data[pairs - 2] == (MAX_ALPHABET_LEN & 0xFF) && data[pairs - 1] == MAX_ALPHABET_LEN >> 8);
+    for (int i = 0; i < MAX_ALPHABET_LEN && pairs + 2 * i + 1 < len; i++) {
+        CHECK(data[pairs + 2 * i] == full->alphabet[i]);
+        CHECK(data[pairs + 2 * i + 1] == full->lengths[i]);
+    }
+
+    Encoding loaded;
+    CHECK(load(path, &loaded) == 0);
+    CHECK(encodings_equal(&loaded, full));
+
+    Encoding *single = encoding_of(weights, 1);
+    single->name[0] = '\0';
+    CHECK(save(path, single) == 0);
+    CHECK(load(path, &loaded) == 0);
+    CHECK(encodings_equal(&loaded, single));
+    CHECK(loaded.lengths[0] == 1 && loaded.codes[0] == 0);
+
+    remove(path);
+    destroyEncoding(full);
+    destroyEncoding(single);
+}
+
+/*
+The version 1 sample encoding of the README loads as the encoding it was written with, and
+decompresses the sample text it compressed in the legacy format.
+*/
+static void test_legacy() {
+    Encoding encoding;
+    CHECK(load(TEST_SAMPLE_DIR "/encoding", &encoding) == 0);
+    CHECK(strcmp(encoding.name, "Test a-f") == 0);
+    CHECK(encoding.alphabetlen == 7);
+    CHECK(memcmp(encoding.alphabet, "abcdef\n", 7) == 0);
+    // The codes of the file, packed first bit lowest
+    static const int lengths[] = {2, 3, 4, 5, 7, 7, 6};
+    static const uint32_t codes[] = {0x1, 0x3, 0xF, 0x17, 0x67, 0x27, 0x7};
+    for (int i = 0; i < 7; i++) {
+        CHECK(encoding.lengths[i] == lengths[i] && encoding.codes[i] == codes[i]);
+    }
+
+    unsigned char text[64];
+    size_t textLen = read_file(TEST_SAMPLE_DIR "/text.txt", text, sizeof(text));
+    CHECK(textLen == 16);
+    FILE *compressed = fopen(TEST_SAMPLE_DIR "/text.cmp", "r");
+    FILE *decompressed = tmpfile();
+    CHECK(compressed != NULL && decompressed != NULL);
+    if (compressed != NULL && decompressed != NULL) {
+        CHECK(decode_file(compressed, decompressed, &encoding, 1, NULL) == 0);
+        unsigned char decoded[64];
+        rewind(decompressed);
+        CHECK(fread(decoded, 1, sizeof(decoded), decompressed) == textLen);
+        CHECK(memcmp(decoded, text, textLen) == 0);
+    }
+    if (compressed != NULL) {
+        fclose(compressed);
+    }
+    if (decompressed != NULL) {
+        fclose(decompressed);
+    }
+}
+
+/*
+Files that are not encodings, of an unknown version, or whose name or (symbol, length) list is
+cut short or holds lengths that are no prefix-free encoding are rejected, and the encoding they
+are loaded into is left as it was.
+*/
+static void test_invalid(const char *dir) {
+    char path[256];
+    char badPath[256];
+    snprintf(path, sizeof(path), "%s/valid.enc", dir);
+    snprintf(badPath, sizeof(badPath), "%s/bad.enc", dir);
+
+    uint64_t weights[16];
+    for (int i = 0; i < 16; i++) {
+        weights[i] = 16 - i;
+    }
+    Encoding *encoding = encoding_of(weights, 16);
+    CHECK(save(path, encoding) == 0);
+    unsigned char data[256];
+    size_t len = read_file(path, data, sizeof(data));
+    // The offset of the alphabet length, after the name "test"
+    size_t alphabetPos = HEADER_SIZE + 3 + 4;
+    CHECK(len == alphabetPos + 2 + 2 * 16);
+
+    Encoding loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(load(TEST_SAMPLE_DIR "/does_not_exist", &loaded) == 1);
+    write_file(badPath, (const unsigned char *) "HFEN", 4);
+    CHECK(load(badPath, &loaded) == 2);
+    write_file(badPath, (const unsigned char *) "HFCMP\x01", 6);
+    CHECK(load(badPath, &loaded) == 2);
+
+    // Versions other than ENC_FORMAT_VERSION
+    for (int version = 0; version < 256; version += 85) {
+        data[HEADER_SIZE + 1] = version == ENC_FORMAT_VERSION ? version + 1 : version;
+        write_file(badPath, data, len);
+        CHECK(load(badPath, &loaded) == 2);
+    }
+    data[HEADER_SIZE + 1] = ENC_FORMAT_VERSION;
+
+    // Every truncation of the compact encoding, down to the marker and version alone
+    for (size_t cut = HEADER_SIZE + 2; cut < len; cut++) {
+        write_file(badPath, data, cut);
+        CHECK(load(badPath, &loaded) == 3);
+    }
+
+    // A name as long as MAX_NAME, an alphabet longer than MAX_ALPHABET_LEN, a length of 0, a
+    // length over MAX_ENC_SIZE_BITS and more short lengths than a prefix-free encoding can have
+    unsigned char bad[256];
+    struct {
+        size_t pos;
+        unsigned char value;
+    } corruptions[] = {
+        {HEADER_SIZE + 2, MAX_NAME},
+        {alphabetPos + 1, (MAX_ALPHABET_LEN + 1) >> 8},
+        {alphabetPos + 2 + 1, 0},
+        {alphabetPos + 2 + 2 * 15 + 1, MAX_ENC_SIZE_BITS + 1},
+        {alphabetPos + 2 + 2 * 3 + 1, 1},
+    };
+    for (size_t i = 0; i < sizeof(corruptions) / sizeof(corruptions[0]); i++) {
+        memcpy(bad, data, len);
+        bad[corruptions[i].pos] = corruptions[i].value;
+        write_file(badPath, bad, len);
+        CHECK(load(badPath, &loaded) == 3);
+    }
+    // A legacy file cut short
+    memcpy(bad, HEADER, HEADER_SIZE);
+    memset(bad + HEADER_SIZE, 0, 100);
+    write_file(badPath, bad, HEADER_SIZE + 100);
+    CHECK(load(badPath, &loaded) == 3);
+
+    // Nothing was loaded by the failed loads
+    CHECK(loaded.alphabetlen == 0);
+    CHECK(load(path, &loaded) == 0);
+    CHECK(encodings_equal(&loaded, encoding));
+
+    remove(path);
+    remove(badPath);
+    destroyEncoding(encoding);
+}
+
+int main() {
+    char dir[] = "/tmp/test_encoding_file_XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    test_round_trip(dir);
+    test_legacy();
+    test_invalid(dir);
+    CHECK(rmdir(dir) == 0);
+    return TEST_RESULT();
+}
@@ -0,0 +1,194 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "test.h"
+#include "../huff_buffer.h"
+#include "../huffman_coding.h"
+
+// The size of the test data, which spans several frame blocks
+#define TEST_DATA_SIZE (2 * HUFF_BLOCK_SIZE + HUFF_BLOCK_SIZE / 2)
+// The number of threads sharing one codec and the number of buffers each of them round trips
+#define TEST_THREADS 4
+#define TEST_THREAD_BUFFERS 50
+
+/*
+The shared state of the round trip threads: the codec and data every thread shares, and the
+seed of the buffers of one thread.
+*/
+typedef struct round_trip_job {
+    const HuffCodec *codec;
+    const unsigned char *data;
+    uint64_t seed;
+} RoundTripJob;
+
+/*
+Compress the <len> bytes at <data> with <codec> and check that they decompress to themselves,
+and that too small destinations and truncated or extended frames are rejected.
+
+Returns the number of checks that failed.
+*/
+static int round_trip(const HuffCodec *codec, const unsigned char *data, size_t len) {
+    int failures = 0;
+    size_t bound = huff_compress_bound(codec, len);
+    unsigned char *frame = malloc(bound + 1);
+    unsigned char *decoded = malloc(len + 1);
+    if (frame == NULL || decoded == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the test buffers\n");
+        exit(1);
+    }
+
+    long frameLen = huff_compress(codec, data, len, frame, bound);
+    failures += frameLen < HUFF_FRAME_HEADER_SIZE;
+    if (frameLen >= HUFF_FRAME_HEADER_SIZE) {
+        failures += frame[8] != (len >= HUFF_STREAMS_MIN_SIZE ? 4 : 1);
+        failures += huff_decompressed_size(frame, frameLen) != (long) len;
+        failures += huff_decompress(codec, frame, frameLen, decoded, len) != (long) len;
+        failures += memcmp(decoded, data, len) != 0;
+
+        failures += huff_compress(codec, data, len, frame, HUFF_FRAME_HEADER_SIZE - 1)
+                    != HUFF_ERROR_DST_SIZE;
+        frameLen = huff_compress(codec, data, len, frame, bound);
+        if (len > 0) {
+            failures += huff_decompress(codec, frame, frameLen, decoded, len - 1)
+                        != HUFF_ERROR_DST_SIZE;
+        }
+        failures += huff_decompress(codec, frame, frameLen - 1, decoded, len) != HUFF_ERROR_CORRUPT;
+        frame[frameLen] = 0;
+        failures += huff_decompress(codec, frame, frameLen + 1, decoded, len) != HUFF_ERROR_CORRUPT;
+    }
+
+    free(frame);
+    free(decoded);
+    return failures;
+}
+
+/*
+The thread function round tripping TEST_THREAD_BUFFERS random slices of the data of the
+RoundTripJob <arg> with its shared codec.
+
+Returns the number of checks that failed, cast to a pointer.
+*/
+static void *round_trip_thread(void *arg) {
+    RoundTripJob *job = arg;
+    intptr_t failures = 0;
+    for (int i = 0; i < TEST_THREAD_BUFFERS; i++) {
+        size_t start = next_random(&job->seed) % TEST_DATA_SIZE;
+        size_t maxLen = i % 10 == 0 ? TEST_DATA_SIZE - start : 10000;
+        size_t len = next_random(&job->seed) % (maxLen + 1);
+        len = start + len > TEST_DATA_SIZE ? TEST_DATA_SIZE - start : len;
+        failures += round_trip(job->codec, job->data + start, len);
+    }
+    return (void *) failures;
+}
+
+/*
+Buffers of every size around the frame's stream and block thresholds round trip, on one thread
+and on TEST_THREADS threads sharing one codec.
+*/
+static void test_round_trips(const HuffCodec *codec, const unsigned char *data) {
+    static const size_t sizes[] = {0, 1, 2, 100, HUFF_STREAMS_MIN_SIZE - 1, HUFF_STREAMS_MIN_SIZE,
+                                   HUFF_STREAMS_MIN_SIZE + 1, HUFF_BLOCK_SIZE - 1, HUFF_BLOCK_SIZE,
+                                   HUFF_BLOCK_SIZE + 1, TEST_DATA_SIZE};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        CHECK(round_trip(codec, data, sizes[i]) == 0);
+    }
+
+    pthread_t threads[TEST_THREADS];
+    RoundTripJob jobs[TEST_THREADS];
+    for (int i = 0; i < TEST_THREADS; i++) {
+        jobs[i].codec = codec;
+        jobs[i].data = data;
+        jobs[i].seed = 0x082EFA98EC4E6C89ULL + i;
+        CHECK(pthread_create(&threads[i], NULL, round_trip_thread, &jobs[i]) == 0);
+    }
+    for (int i = 0; i < TEST_THREADS; i++) {
+        void *failures;
+        pthread_join(threads[i], &failures);
+        CHECK(failures == NULL);
+    }
+}
+
+/*
+Symbols outside of the codec's alphabet, frame headers that are cut short or do not match their
+size, and frames that are corrupted anywhere are rejected without writing past the destination.
+*/
+static void test_errors(const HuffCodec *codec, const unsigned char *data) {
+    unsigned char input[5000];
+    memcpy(input, data, sizeof(input));
+    input[4000] = 200;
+    size_t bound = huff_compress_bound(codec, sizeof(input));
+    unsigned char *frame = malloc(bound);
+    unsigned char decoded[sizeof(input)];
+    CHECK(huff_compress(codec, input, sizeof(input), frame, bound) == HUFF_ERROR_ALPHABET);
+
+    long frameLen = huff_compress(codec, data, sizeof(input), frame, bound);
+    CHECK(frameLen > 0);
+    CHECK(huff_decompressed_size(frame, HUFF_FRAME_HEADER_SIZE - 1) == HUFF_ERROR_CORRUPT);
+    CHECK(huff_decompress(codec, frame, HUFF_FRAME_HEADER_SIZE - 1, decoded, sizeof(decoded))
+          == HUFF_ERROR_CORRUPT);
+
+    // The number of streams must be the one of the frame's size
+    frame[8] = 1;
+    CHECK(huff_decompress(codec, frame, frameLen, decoded, sizeof(decoded)) == HUFF_ERROR_CORRUPT);
+    frame[8] = 4;
+
+    // Flipping any byte of the blocks either fails or decodes to the right size
+    uint64_t state = 0x452821E638D01377ULL;
+    for (int i = 0; i < 200; i++) {
+        long pos = HUFF_FRAME_HEADER_SIZE
+                   + next_random(&state) % (frameLen - HUFF_FRAME_HEADER_SIZE);
+        unsigned char flip = 1 + next_random(&state) % 255;
+        frame[pos] ^= flip;
+        long ret = huff_decompress(codec, frame, frameLen, decoded, sizeof(decoded));
+        CHECK(ret == HUFF_ERROR_CORRUPT || ret == (long) sizeof(input));
+        frame[pos] ^= flip;
+    }
+    CHECK(huff_decompress(codec, frame, frameLen, decoded, sizeof(decoded))
+          == (long) sizeof(input));
+    CHECK(memcmp(decoded, data, sizeof(input)) == 0);
+    free(frame);
+
+    // An encoding without a code for one of its symbols has no codec
+    uint64_t weights[16];
+    for (int i = 0; i < 16; i++) {
+        weights[i] = 1 + (16 - i) * (16 - i);
+    }
+    Encoding *encoding = encoding_of(weights, 16);
+    encoding->lengths[3] = 0;
+    CHECK(newHuffCodec(encoding) == NULL);
+    destroyEncoding(encoding);
+}
+
+int main() {
+    // The first half of the byte values, the lower ones more frequent
+    uint64_t weights[MAX_ALPHABET_LEN / 2];
+    for (int i = 0; i < MAX_ALPHABET_LEN / 2; i++) {
+        weights[i] = 1 + (uint64_t) (MAX_ALPHABET_LEN / 2 - i) * (MAX_ALPHABET_LEN / 2 - i);
+    }
+    Encoding *encoding = encoding_of(weights, MAX_ALPHABET_LEN / 2);
+    HuffCodec *codec = newHuffCodec(encoding);
+    CHECK(codec != NULL);
+    if (codec == NULL) {
+        return TEST_RESULT();
+    }
+
+    // Bytes of the first half of the alphabet, mostly the frequent ones
+    unsigned char *data = malloc(TEST_DATA_SIZE);
+    if (data == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the test data\n");
+        exit(1);
+    }
+    uint64_t state = 0xBE5466CF34E90C6CULL;
+    for (size_t i = 0; i < TEST_DATA_SIZE; i++) {
+        data[i] = random_symbol(&state, MAX_ALPHABET_LEN / 2);
+    }
+
+    test_round_trips(codec, data);
+    test_errors(codec, data);
+
+    free(data);
+    destroyHuffCodec(codec);
+    destroyEncoding(encoding);
+    return TEST_RESULT();
+}
@@ -0,0 +1,198 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "test.h"
+#include "../encoding.h"
+#include "../huffman_coding.h"
+
+// The number of symbols of the alphabets whose best lengths are found by brute force
+#define TEST_BRUTE_FORCE_SYMBOLS 7
+
+/*
+Returns the total encoded size in bits of the symbols of <freqs> with <encoding>.
+*/
+static uint64_t encoded_size(const Encoding *encoding, const Frequencies *freqs) {
+    uint64_t size = 0;
+    for (int i = 0; i < freqs->alphabetlen; i++) {
+        size += freqs->frequencies[i] * encoding->lengths[i];
+    }
+    return size;
+}
+
+/*
+Check that every encoding of <encoding> is between 1 and <maxLength> bits, that no encoding is a
+prefix of another and that the encodings are complete (their Kraft sum is exactly 1).
+*/
+static void check_limited_prefix_free(const Encoding *encoding, int maxLength) {
+    int n = encoding->alphabetlen;
+    uint64_t kraft = 0;
+    for (int i = 0; i < n; i++) {
+        CHECK(encoding->lengths[i] >= 1 && encoding->lengths[i] <= maxLength);
+        kraft += 1ULL << (MAX_ENC_SIZE_BITS - encoding->lengths[i]);
+    }
+    CHECK(n < 2 || kraft == 1ULL << MAX_ENC_SIZE_BITS);
+
+    // Encodings are packed first bit lowest, so a prefix is a match of the lowest bits
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            if (i != j && encoding->lengths[i] <= encoding->lengths[j]) {
+                uint32_t mask = (uint32_t) ((1ULL << encoding->lengths[i]) - 1);
+                CHECK((encoding->codes[j] & mask) != encoding->codes[i]);
+            }
+        }
+    }
+}
+
+/*
+Returns the smallest total encoded size in bits of <freqs> with encodings of at most <maxLength>
+bits, found by trying every assignment of lengths that satisfies the Kraft inequality.
+*/
+static uint64_t brute_force_size(const Frequencies *freqs, int maxLength) {
+    int n = freqs->alphabetlen;
+    int lengths[TEST_BRUTE_FORCE_SYMBOLS];
+    for (int i = 0; i < n; i++) {
+        lengths[i] = 1;
+    }
+
+    uint64_t best = UINT64_MAX;
+    while (1) {
+        uint64_t kraft = 0;
+        uint64_t size = 0;
+        for (int i = 0; i < n; i++) {
+            kraft += 1ULL << (maxLength - lengths[i]);
+            size += freqs->frequencies[i] * lengths[i];
+        }
+        if (kraft <= 1ULL << maxLength && size < best) {
+            best = size;
+        }
+
+        // The next assignment of lengths, counting in base maxLength
+        int i = 0;
+        while (i < n && lengths[i] == maxLength) {
+            lengths[i++] = 1;
+        }
+        if (i == n) {
+            return best;
+        }
+        lengths[i]++;
+    }
+}
+
+/*
+Fibonacci weights give the deepest Huffman tree: 40 symbols need encodings of 39 bits. Every limit
+gives a complete prefix-free encoding within the limit, a looser limit never makes it larger, and
+generateEncoding() falls back to the MAX_ENC_SIZE_BITS limit.
+*/
+static void test_fibonacci() {
+    uint64_t weights[40];
+    weights[0] = 1;
+    weights[1] = 1;
+    for (int i = 2; i < 40; i++) {
+        weights[i] = weights[i - 1] + weights[i - 2];
+    }
+    Frequencies freqs = frequencies_of(weights, 40);
+    char name[MAX_NAME] = "test";
+
+    uint64_t previousSize = UINT64_MAX;
+    for (int maxLength = 6; maxLength <= MAX_ENC_SIZE_BITS; maxLength++) {
+        Encoding *encoding = generateLengthLimitedEncoding(freqs, name, maxLength);
+        CHECK(encoding != NULL);
+        if (encoding == NULL) {
+            continue;
+        }
+        CHECK(encoding->alphabetlen == 40);
+        check_limited_prefix_free(encoding, maxLength);
+        uint64_t size = encoded_size(encoding, &freqs);
+        CHECK(size <= previousSize);
+        previousSize = size;
+        destroyEncoding(encoding);
+    }
+
+    Encoding *limited = generateLengthLimitedEncoding(freqs, name, MAX_ENC_SIZE_BITS);
+    Encoding *huffman = generateEncoding(freqs, name);
+    check_limited_prefix_free(huffman, MAX_ENC_SIZE_BITS);
+    CHECK(encoded_size(huffman, &freqs) == encoded_size(limited, &freqs));
+    destroyEncoding(limited);
+    destroyEncoding(huffman);
+}
+
+/*
+With a limit no Huffman encoding reaches, the length-limited encoding is as small as the Huffman
+encoding, and with any limit it is as small as the best lengths found by brute force.
+*/
+static void test_optimal() {
+    uint64_t state = 0x13198A2E03707344ULL;
+    char name[MAX_NAME] = "test";
+    uint64_t weights[MAX_ALPHABET_LEN];
+
+    for (int run = 0; run < 50; run++) {
+        int n = 2 + next_random(&state) % (MAX_ALPHABET_LEN - 1);
+        for (int i = 0; i < n; i++) {
+            weights[i] = 1 + next_random(&state) % 1000;
+        }
+        Frequencies freqs = frequencies_of(weights, n);
+        Encoding *huffman = generateEncoding(freqs, name);
+        Encoding *limited = generateLengthLimitedEncoding(freqs, name, MAX_ENC_SIZE_BITS);
+        check_limited_prefix_free(limited, MAX_ENC_SIZE_BITS);
+        CHECK(encoded_size(limited, &freqs) == encoded_size(huffman, &freqs));
+        destroyEncoding(huffman);
+        destroyEncoding(limited);
+    }
+
+    for (int run = 0; run < 20; run++) {
+        for (int i = 0; i < TEST_BRUTE_FORCE_SYMBOLS; i++) {
+            // Skewed weights, so the limits below cut the Huffman lengths
+            weights[i] = 1 + next_random(&state) % (1ULL << (2 * i + 1));
+        }
+        Frequencies freqs = frequencies_of(weights, TEST_BRUTE_FORCE_SYMBOLS);
+        for (int maxLength = 3; maxLength <= 6; maxLength++) {
+            Encoding *limited = generateLengthLimitedEncoding(freqs, name, maxLength);
+            check_limited_prefix_free(limited, maxLength);
+            CHECK(encoded_size(limited, &freqs) == brute_force_size(&freqs, maxLength));
+            destroyEncoding(limited);
+        }
+    }
+}
+
+/*
+Limits outside 1 to MAX_ENC_SIZE_BITS and alphabets with more symbols than encodings of the limit
+are rejected, an alphabet that exactly fills the limit gets equal lengths, and a single symbol
+gets the 1 bit encoding 0.
+*/
+static void test_limits() {
+    char name[MAX_NAME] = "test";
+    uint64_t weights[MAX_ALPHABET_LEN];
+    for (int i = 0; i < MAX_ALPHABET_LEN; i++) {
+        weights[i] = 1 + i * i;
+    }
+    Frequencies freqs = frequencies_of(weights, MAX_ALPHABET_LEN);
+
+    CHECK(generateLengthLimitedEncoding(freqs, name, 0) == NULL);
+    CHECK(generateLengthLimitedEncoding(freqs, name, MAX_ENC_SIZE_BITS + 1) == NULL);
+    CHECK(generateLengthLimitedEncoding(freqs, name, 7) == NULL);
+
+    Encoding *encoding = generateLengthLimitedEncoding(freqs, name, 8);
+    CHECK(encoding != NULL);
+    if (encoding != NULL) {
+        for (int i = 0; i < MAX_ALPHABET_LEN; i++) {
+            CHECK(encoding->lengths[i] == 8);
+        }
+        check_limited_prefix_free(encoding, 8);
+        destroyEncoding(encoding);
+    }
+
+    Frequencies single = frequencies_of(weights, 1);
+    encoding = generateLengthLimitedEncoding(single, name, 4);
+    CHECK(encoding != NULL);
+    if (encoding != NULL) {
+        CHECK(encoding->alphabetlen == 1);
+        CHECK(encoding->lengths[0] == 1 && encoding->codes[0] == 0);
+        destroyEncoding(encoding);
+    }
+}
+
+int main() {
+    test_fibonacci();
+    test_optimal();
+    test_limits();
+    return TEST_RESULT();
+}
@@ -0,0 +1,192 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "../codec.h"
+#include "../encoding.h"
+#include "../huffman_coding.h"
+
+// The number of bytes after the decoded symbols that are checked to be left alone
+#define TEST_GUARD_SIZE 64
+#define TEST_GUARD_BYTE 0xA7
+
+/*
+Encode <len> random symbols below <alphabetLen> with <encodeTable> as 1 and CODEC_STREAMS streams
+and check that they decode with <decodeTable> to exactly the symbols, leaving the bytes after them
+alone. The single stream must be the output of encode_block(), and the jump table of the
+interleaved streams must add up to the size of the output. Truncating the interleaved streams or
+making their jump table point past the end must fail to decode.
+*/
+static void check_round_trip(const EncodeTable *encodeTable, const DecodeTable *decodeTable,
+                             int alphabetLen, size_t len, uint64_t *state) {
+    unsigned char *input = malloc(len > 0 ? len : 1);
+    unsigned char *single = malloc(ENCODE_BOUND(len));
+    unsigned char *encoded = malloc(ENCODE_BOUND(len));
+    unsigned char *decoded = malloc(len + TEST_GUARD_SIZE);
+    if (input == NULL || single == NULL || encoded == NULL || decoded == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the test buffers\n");
+        exit(1);
+    }
+    // Mostly the first symbols, so the encodings have many different lengths
+    for (size_t i = 0; i < len; i++) {
+        input[i] = random_symbol(state, alphabetLen);
+    }
+
+    long singleLen = encode_block(encodeTable, input, len, single);
+    CHECK(singleLen >= 0);
+    for (int numStreams = 1; numStreams <= CODEC_STREAMS; numStreams += CODEC_STREAMS - 1) {
+        long encodedLen = encode_block_streams(encodeTable, input, len, numStreams, encoded);
+        CHECK(encodedLen >= CODEC_JUMP_TABLE_SIZE(numStreams));
+        if (numStreams == 1) {
+            CHECK(encodedLen == singleLen && memcmp(encoded, single, singleLen) == 0);
+        } else {
+            size_t streamsLen = CODEC_JUMP_TABLE_SIZE(numStreams);
+            for (int i = 0; i < numStreams - 1; i++) {
+                streamsLen += get_le(&encoded[4 * i], 4);
+            }
+            CHECK(streamsLen <= (size_t) encodedLen);
+        }
+
+        memset(decoded, TEST_GUARD_BYTE, len + TEST_GUARD_SIZE);
+        CHECK(decode_block_streams(decodeTable, encoded, encodedLen, numStreams, decoded,
+                                   len) == 0);
+        CHECK(memcmp(decoded, input, len) == 0);
+        for (int i = 0; i < TEST_GUARD_SIZE; i++) {
+            CHECK(decoded[len + i] == TEST_GUARD_BYTE);
+        }
+
+        if (len > 0) {
+            CHECK(decode_block_streams(decodeTable, encoded, encodedLen - 1, numStreams, decoded,
+                                       len) == 1);
+        }
+        if (numStreams > 1) {
+            encoded[0] = encoded[1] = encoded[2] = encoded[3] = 0xFF;
+            CHECK(decode_block_streams(decodeTable, encoded, encodedLen, numStreams, decoded,
+                                       len) == 1);
+        }
+    }
+
+    free(input);
+    free(single);
+    free(encoded);
+    free(decoded);
+}
+
+/*
+Blocks of every size around the streams' segment boundaries and the fast decode loop's runs round
+trip, both with a full byte alphabet and with an alphabet of long encodings.
+*/
+static void test_round_trips() {
+    static const size_t sizes[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 63, 64, 65, 100, 255,
+                                   256, 257, 1000, 4095, 4096, 4097, 65537, 300001};
+    int numSizes = sizeof(sizes) / sizeof(sizes[0]);
+    uint64_t state = 0xA4093822299F31D0ULL;
+
+    uint64_t weights[MAX_ALPHABET_LEN];
+    for (int i = 0; i < MAX_ALPHABET_LEN; i++) {
+        uint64_t rank = MAX_ALPHABET_LEN - i;
+        weights[i] = 1 + rank * rank * rank;
+    }
+    Encoding *bytes = encoding_of(weights, MAX_ALPHABET_LEN);
+
+    // Fibonacci weights in decreasing order give the first symbols 1, 2, 3, ... bit encodings
+    weights[39] = weights[38] = 1;
+    for (int i = 37; i >= 0; i--) {
+        weights[i] = weights[i + 1] + weights[i + 2];
+    }
+    Encoding *deep = encoding_of(weights, 40);
+
+    Encoding *encodings[] = {bytes, deep};
+    for (int e = 0; e < 2; e++) {
+        EncodeTable *encodeTable = newEncodeTable(encodings[e]);
+        DecodeTable *decodeTable = newDecodeTable(encodings[e]);
+        CHECK(encodeTable != NULL && decodeTable != NULL);
+        if (encodeTable == NULL || decodeTable == NULL) {
+            continue;
+        }
+        for (int i = 0; i < numSizes; i++) {
+            check_round_trip(encodeTable, decodeTable, encodings[e]->alphabetlen, sizes[i], &state);
+        }
+        destroyEncodeTable(encodeTable);
+        destroyDecodeTable(decodeTable);
+    }
+    destroyEncoding(bytes);
+    destroyEncoding(deep);
+}
+
+/*
+A symbol outside of the encoding alphabet fails to encode in any stream, and a block of a number
+of streams other than 1 or CODEC_STREAMS, or too short for its jump table, fails to decode.
+*/
+static void test_errors() {
+    uint64_t weights[16];
+    for (int i = 0; i < 16; i++) {
+        weights[i] = 16 - i;
+    }
+    Encoding *encoding = encoding_of(weights, 16);
+    EncodeTable *encodeTable = newEncodeTable(encoding);
+    DecodeTable *decodeTable = newDecodeTable(encoding);
+
+    unsigned char input[1000];
+    for (int i = 0; i < 1000; i++) {
+        input[i] = i % 16;
+    }
+    unsigned char encoded[ENCODE_BOUND(1000)];
+    unsigned char decoded[1000];
+    for (int pos = 0; pos < 1000; pos += 333) {
+        input[pos] = 200;
+        CHECK(encode_block(encodeTable, input, 1000, encoded) == -1);
+        CHECK(encode_block_streams(encodeTable, input, 1000, CODEC_STREAMS, encoded) == -1);
+        input[pos] = pos % 16;
+    }
+
+    long encodedLen = encode_block_streams(encodeTable, input, 1000, CODEC_STREAMS, encoded);
+    CHECK(encodedLen > 0);
+    CHECK(decode_block_streams(decodeTable, encoded, encodedLen, 3, decoded, 1000) == 1);
+    CHECK(decode_block_streams(decodeTable, encoded, CODEC_JUMP_TABLE_SIZE(CODEC_STREAMS) - 1,
+                               CODEC_STREAMS, decoded, 0) == 1);
+    CHECK(decode_block_streams(decodeTable, encoded, encodedLen, CODEC_STREAMS, decoded,
+                               1000) == 0);
+    CHECK(memcmp(decoded, input, 1000) == 0);
+
+    destroyEncodeTable(encodeTable);
+    destroyDecodeTable(decodeTable);
+    destroyEncoding(encoding);
+}
+
+/*
+The decode table of an encoding with a MAX_ENC_SIZE_BITS bit encoding gets one secondary table
+of the remaining bits, and an encoding whose lengths break the Kraft inequality is rejected.
+*/
+static void test_decode_table_size() {
+    Encoding *encoding = newEncoding("test");
+    const int lengths[] = {1, 2, MAX_ENC_SIZE_BITS};
+    // 0, 10 and 11 followed by zeros in stream order (the first bit is the lowest bit)
+    const uint32_t codes[] = {0x0, 0x1, 0x3};
+    for (int i = 0; i < 3; i++) {
+        encoding->alphabet[i] = 'a' + i;
+        encoding->lengths[i] = lengths[i];
+        encoding->codes[i] = codes[i];
+    }
+    encoding->alphabetlen = 3;
+    DecodeTable *decodeTable = newDecodeTable(encoding);
+    CHECK(decodeTable != NULL);
+    if (decodeTable != NULL) {
+        CHECK(decodeTable->numEntries
+              == DECODE_TABLE_SIZE + ((size_t) 1 << (MAX_ENC_SIZE_BITS - DECODE_TABLE_BITS)));
+        CHECK(decodeTable->numEntries <= DECODE_MAX_ENTRIES(encoding->alphabetlen));
+        destroyDecodeTable(decodeTable);
+    }
+
+    // Two encodings of 1 bit leave no room for any other encoding
+    encoding->lengths[1] = 1;
+    CHECK(newDecodeTable(encoding) == NULL);
+    destroyEncoding(encoding);
+}
+
+int main() {
+    test_round_trips();
+    test_errors();
+    test_decode_table_size();
+    return TEST_RESULT();
+}